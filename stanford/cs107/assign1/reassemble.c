@@ -22,9 +22,110 @@
  * Decrease the count of fragments by one.
  * Concatenation of fragments occurs when no overlap is found in any pair.
  * Continue until there is a single fragment.
+ * Ties are broken in favor of the pair (i, j) that comes first in the array.
+ *
+ * Pruning:
+ * Neither overlap of a pair (i, j) can be longer than fragment i, and a
+ * prefix/suffix overlap cannot be longer than fragment j either.
+ * The pairs are searched row by row, longest fragment i first, using an
+ * index of the fragments sorted by length that is kept up to date across
+ * passes. Once a row's length cannot beat the best overlap found so far,
+ * neither can any later row, and the search stops.
+ *
+ * Packed symbols:
+ * If the fragments use at most 32 distinct characters, each is also kept
+ * packed into 2, 4 or 5 bits per character, according to that number.
+ * The containment and overlap checks of exact, tiled and round mode
+ * then find the positions that start like the other fragment a word of
+ * symbols at a time, and compare those a word at a time. Merged
+ * fragments are packed again from their text, which is kept for output.
+ *
+ * Approximate mode:
+ * Fragments from noisy sources carry typos, which defeat exact matching.
+ * With -k, two fragments also overlap when they differ in at most k
+ * characters over the overlap. Candidate pairs are found through shared
+ * minimizers: the smallest hash among each window of SEED_WINDOW
+ * consecutive SEED_LEN-grams. A shared minimizer fixes the diagonal on
+ * which the fragments would align, and the candidate is verified by a
+ * bit-parallel edit distance in a band of diagonals around it, so that
+ * insertions and deletions are tolerated as well as substitutions. The
+ * overlap then ends where the alignment leaves x, not where the seeded
+ * diagonal does.
+ * Verified overlaps go into a heap and are merged greedily, longest
+ * first; a merged fragment is seeded again to find its own overlaps.
+ * Fragments left without any approximate overlap are then reassembled
+ * exactly.
+ *
+ * Batch mode:
+ * With -b, the argument is a manifest listing one input file per line.
+ * The files are reassembled concurrently by a pool of -j threads (one
+ * per processor by default), each claiming the next unclaimed file.
+ * Each result is written next to its input, with the extension replaced
+ * by .out, and a summary gives the time spent on every file.
+ *
+ * Tiled mode:
+ * With -t, the overlaps of all pairs are computed once, up front, into
+ * a matrix of 16-bit entries. The matrix is filled one tile at a time, a
+ * tile pairing two blocks of fragments that fit in cache together, and
+ * the memory and time of each tile are reported on stderr. Each pass
+ * then only recomputes the overlaps of the fragment it merged. The
+ * result is the same as without -t.
+ *
+ * Round mode:
+ * With -r, passes give way to rounds. A round merges at once every pair
+ * that beats all the other overlaps of both its fragments, on -j threads,
+ * so about log n rounds replace the n - 1 passes. Ties are broken by a
+ * hash rather than by position, so the result can differ from the one
+ * without -r.
+ *
+ * Time budget and checkpoints:
+ * With --time-budget, the reassembly stops between two passes (or rounds)
+ * once the given number of seconds has gone by, and prints the contigs
+ * it has so far, concatenated. With --checkpoint, the fragments left,
+ * and the overlap matrix in tiled mode, are written to the given file
+ * every CHECKPOINT_INTERVAL seconds and when the budget runs out. A run
+ * started with a checkpoint file that exists resumes from it, provided
+ * it was written for the same input, and a finished run removes it.
+ *
+ * Compressed input:
+ * An input file, or a file in a manifest, may be gzip compressed (or zstd
+ * compressed, in a build with HAVE_ZSTD), told apart by its first bytes.
+ * A thread decompresses it into a ring of blocks while the fragments are
+ * parsed from the blocks already there.
+ *
+ * Out-of-core mode:
+ * With --store, the fragments are written to the given file as they are
+ * read, and mapped from it, so that only their positions, a fingerprint
+ * of the first SEED_LEN characters of each, and the overlaps found stay
+ * in memory. Each fragment is looked up at every position of the others
+ * by fingerprint to find the fragments it contains and its overlaps of
+ * at least SEED_LEN characters. Fragments are then chained along these,
+ * longest first, then along the shorter overlaps of the ends of chains,
+ * and the chains are written out piece by piece. Overlaps are those of
+ * the input fragments, not of the merged ones, so the result can differ
+ * from the one without --store. The store file is removed once mapped.
+ *
+ * Incremental mode:
+ * With --index, the fragments are reassembled as with --store, in memory,
+ * together with the contigs of the given index file if it exists. The
+ * contigs linked by overlaps of at least SEED_LEN characters, before
+ * their ends are joined, are then written back to it, with a seed of the
+ * SEED_LEN characters at every position of them. Only the new fragments are
+ * looked up, in the seeds and in each other, so a run computes the
+ * overlaps and merges of the new fragments only, though the index file
+ * is read and written whole. Seeds are computed again only for the
+ * contigs that changed.
  *
  * Args:
- * Path of the file to be reassembled.
+ * 1. Optionally, one of -k and the number of mismatches to tolerate
+ *    (default 0), -t for tiled mode or -r for round mode
+ * 2. Optionally, -j and the number of threads (one per processor by
+ *    default) of round mode, or of batch mode
+ * 3. Optionally, --time-budget and a number of seconds, and --checkpoint
+ *    and the path of a checkpoint file
+ * 4. Optionally, --store and the path of a store file, or --index and
+ *    the path of an index file, alone
+ * 5. Path of the file to be reassembled, or -b and the path of a manifest
  *
  * Result:
  * Print the final merged fragment to the console.
@@ -33,19 +134,54 @@
  * CS107 Stanford
  */
 
+#define _GNU_SOURCE // fopencookie
 #include <stdio.h>
 #include <string.h>
 #include <stdlib.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <getopt.h>
+#include <pthread.h>
+#include <time.h>
 #include <wctype.h>
+#include <errno.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 #include <assert.h>
+#include <zlib.h>
+#ifdef HAVE_ZSTD
+#include <zstd.h>
+#endif
 
 enum {
     MAX_FRAG_LEN = 10000,
     MAX_FRAG_COUNT = 5000,
     START_FRAG_TOKEN = '{',
     END_FRAG_TOKEN = '}',
+    SEED_LEN = 12, // characters per seed
+    SEED_WINDOW = 8, // seeds per minimizer window
+    MAX_SEED_HITS = 256, // index entries examined per minimizer
+    MIN_APPROX_OVERLAP = 24, // shortest approximate overlap accepted
+    MAX_APPROX_BAND = 31, // diagonals an approximate overlap may stray
+    MAX_BATCH_THREADS = 64,
+    OVERLAP_CONTAINED = 0x8000, // flag of a tiled matrix entry
+    MAX_TILED_LEN = 0x7fff, // longest fragment a matrix entry can describe
+    TILE_CACHE_BYTES = 256 * 1024, // fragment text per tile, about L2 size
+    CHECKPOINT_INTERVAL = 60, // seconds between checkpoints
+    RING_BLOCKS = 8, // decompressed blocks the reader can be behind by
+    RING_BLOCK_SIZE = 64 * 1024,
 };
 
+/* The options of a reassembly, from the command line */
+typedef struct {
+    int max_mismatches; // -k
+    int tiled; // -t
+    int rounds; // -r
+    int n_threads; // -j, threads of a round
+    double time_budget; // --time-budget, in seconds, 0 if none
+    const char *checkpoint; // --checkpoint
+} reassemble_opts;
+
 #ifdef DEBUG
 # define print_arr debug_print_arr
 # define clear_buf debug_clear_buf
@@ -189,6 +325,311 @@ int read_all_frags(FILE *fp, char *arr[])
     return i;
 }
 
+/* The formats of an input file, told apart by their first bytes */
+enum {
+    INPUT_PLAIN,
+    INPUT_GZIP,
+    INPUT_ZSTD,
+};
+
+/*
+ * A bounded ring of decompressed blocks. The decompressor thread fills
+ * it from the compressed file while the reader parses the blocks already
+ * there, through a FILE * made by fopencookie, so that read_frag is
+ * unchanged.
+ */
+typedef struct {
+    FILE *src; // the compressed file
+    int format;
+    char *blocks[RING_BLOCKS];
+    size_t sizes[RING_BLOCKS];
+    int head; // next block to fill
+    int tail; // block being read
+    int count; // blocks filled and not yet read
+    size_t read_pos; // position in the tail block
+    int done; // the decompressor has pushed its last block
+    int failed; // the input is corrupt or unreadable
+    int cancelled; // the reader closed the stream before the end
+    pthread_mutex_t lock;
+    pthread_cond_t not_empty;
+    pthread_cond_t not_full;
+    pthread_t thread;
+} inflate_ring;
+
+/*
+ * Called by the decompressor with a full block.
+ * Wait for room, and hand the block over.
+ * Return the next block to fill, or NULL if the reader has gone.
+ */
+char *ring_push(inflate_ring *r, size_t size)
+{
+    char *next;
+
+    pthread_mutex_lock(&r->lock);
+    r->sizes[r->head] = size;
+    r->head = (r->head + 1) % RING_BLOCKS;
+    r->count++;
+    pthread_cond_signal(&r->not_empty);
+    while (r->count == RING_BLOCKS && !r->cancelled) {
+        pthread_cond_wait(&r->not_full, &r->lock);
+    }
+    next = r->cancelled ? NULL : r->blocks[r->head];
+    pthread_mutex_unlock(&r->lock);
+    return next;
+}
+
+/* Called by the decompressor when it is done, or has failed */
+void ring_finish(inflate_ring *r, int failed)
+{
+    pthread_mutex_lock(&r->lock);
+    r->done = 1;
+    r->failed = failed;
+    pthread_cond_signal(&r->not_empty);
+    pthread_mutex_unlock(&r->lock);
+}
+
+/*
+ * Inflate gzip members, one after the other, into blocks.
+ * Return -1 if the data is not valid gzip.
+ */
+int inflate_gzip(inflate_ring *r)
+{
+    unsigned char in[RING_BLOCK_SIZE];
+    z_stream zs;
+    char *block = r->blocks[r->head];
+    int ret = Z_OK;
+
+    memset(&zs, 0, sizeof(zs));
+    if (inflateInit2(&zs, 15 + 16) != Z_OK) {
+        return -1;
+    }
+    zs.next_out = (unsigned char *)block;
+    zs.avail_out = RING_BLOCK_SIZE;
+    while (block != NULL) {
+        if (zs.avail_in == 0) {
+            zs.avail_in = fread(in, 1, sizeof(in), r->src);
+            zs.next_in = in;
+            if (zs.avail_in == 0) {
+                break;
+            }
+        }
+        ret = inflate(&zs, Z_NO_FLUSH);
+        if (ret == Z_STREAM_END) {
+            inflateReset(&zs); // another member may follow
+        }
+        else
+        if (ret != Z_OK) {
+            break;
+        }
+        if (zs.avail_out == 0) {
+            block = ring_push(r, RING_BLOCK_SIZE);
+            zs.next_out = (unsigned char *)block;
+            zs.avail_out = RING_BLOCK_SIZE;
+        }
+    }
+    if (block != NULL && zs.avail_out < RING_BLOCK_SIZE) {
+        ring_push(r, RING_BLOCK_SIZE - zs.avail_out);
+    }
+    inflateEnd(&zs);
+    // A stream that ends in the middle of a member is truncated
+    if (ferror(r->src) || (ret != Z_OK && ret != Z_STREAM_END) ||
+        (ret == Z_OK && zs.total_in > 0 && block != NULL)) {
+        fprintf(stderr, "Detected corrupt or truncated gzip input.\n");
+        return -1;
+    }
+    return 0;
+}
+
+#ifdef HAVE_ZSTD
+/*
+ * Decompress zstd frames, one after the other, into blocks.
+ * Return -1 if the data is not valid zstd.
+ */
+int inflate_zstd(inflate_ring *r)
+{
+    unsigned char in[RING_BLOCK_SIZE];
+    ZSTD_DCtx *dctx;
+    ZSTD_inBuffer zin = {in, 0, 0};
+    ZSTD_outBuffer zout = {r->blocks[r->head], RING_BLOCK_SIZE, 0};
+    size_t ret = 0;
+
+    dctx = ZSTD_createDCtx();
+    if (dctx == NULL) {
+        return -1;
+    }
+    while (zout.dst != NULL) {
+        if (zin.pos == zin.size) {
+            zin.size = fread(in, 1, sizeof(in), r->src);
+            zin.pos = 0;
+            if (zin.size == 0) {
+                break;
+            }
+        }
+        ret = ZSTD_decompressStream(dctx, &zout, &zin);
+        if (ZSTD_isError(ret)) {
+            break;
+        }
+        if (zout.pos == zout.size) {
+            zout.dst = ring_push(r, RING_BLOCK_SIZE);
+            zout.pos = 0;
+        }
+    }
+    if (zout.dst != NULL && zout.pos > 0) {
+        ring_push(r, zout.pos);
+    }
+    ZSTD_freeDCtx(dctx);
+    // ret is 0 only at the end of a frame
+    if (ferror(r->src) || ZSTD_isError(ret) || (zout.dst != NULL && ret != 0)) {
+        fprintf(stderr, "Detected corrupt or truncated zstd input.\n");
+        return -1;
+    }
+    return 0;
+}
+#endif
+
+/* The decompressor thread */
+void *inflate_thread(void *arg)
+{
+    inflate_ring *r = arg;
+    int failed;
+
+#ifdef HAVE_ZSTD
+    failed = r->format == INPUT_ZSTD ? inflate_zstd(r) : inflate_gzip(r);
+#else
+    failed = inflate_gzip(r);
+#endif
+    ring_finish(r, failed);
+    return NULL;
+}
+
+/* fopencookie read function: copy out of the blocks, in order */
+ssize_t ring_read(void *cookie, char *buf, size_t size)
+{
+    inflate_ring *r = cookie;
+    size_t n;
+
+    pthread_mutex_lock(&r->lock);
+    while (r->count == 0 && !r->done) {
+        pthread_cond_wait(&r->not_empty, &r->lock);
+    }
+    if (r->count == 0) {
+        pthread_mutex_unlock(&r->lock);
+        if (r->failed) {
+            errno = EIO;
+            return -1;
+        }
+        return 0; // end of file
+    }
+    pthread_mutex_unlock(&r->lock);
+
+    // The tail block is the reader's own until it is released
+    n = r->sizes[r->tail] - r->read_pos;
+    n = n < size ? n : size;
+    memcpy(buf, r->blocks[r->tail] + r->read_pos, n);
+    r->read_pos += n;
+    if (r->read_pos == r->sizes[r->tail]) {
+        pthread_mutex_lock(&r->lock);
+        r->tail = (r->tail + 1) % RING_BLOCKS;
+        r->count--;
+        r->read_pos = 0;
+        pthread_cond_signal(&r->not_full);
+        pthread_mutex_unlock(&r->lock);
+    }
+    return n;
+}
+
+/* fopencookie close function: stop the decompressor and free the ring */
+int ring_close(void *cookie)
+{
+    inflate_ring *r = cookie;
+    int i;
+
+    pthread_mutex_lock(&r->lock);
+    r->cancelled = 1;
+    pthread_cond_signal(&r->not_full);
+    pthread_mutex_unlock(&r->lock);
+    pthread_join(r->thread, NULL);
+    for (i = 0; i < RING_BLOCKS; i++) {
+        free(r->blocks[i]);
+    }
+    pthread_mutex_destroy(&r->lock);
+    pthread_cond_destroy(&r->not_empty);
+    pthread_cond_destroy(&r->not_full);
+    fclose(r->src);
+    free(r);
+    return 0;
+}
+
+/*
+ * Open the input file at filename for reading. A gzip or zstd file is
+ * decompressed on a thread of its own as it is read.
+ * Return NULL after printing an error if it cannot be opened.
+ */
+FILE *open_input(const char *filename)
+{
+    static const unsigned char gzip_magic[2] = {0x1f, 0x8b};
+    static const unsigned char zstd_magic[4] = {0x28, 0xb5, 0x2f, 0xfd};
+    cookie_io_functions_t io = {ring_read, NULL, NULL, ring_close};
+    unsigned char magic[4];
+    inflate_ring *r;
+    FILE *fp, *stream;
+    size_t n;
+    int i, format = INPUT_PLAIN;
+
+    fp = fopen(filename, "r");
+    if (fp == NULL) {
+        fprintf(stderr, "Cannot open file \"%s\"\n", filename);
+        return NULL;
+    }
+    n = fread(magic, 1, sizeof(magic), fp);
+    if (n >= 2 && memcmp(magic, gzip_magic, 2) == 0) {
+        format = INPUT_GZIP;
+    }
+    else
+    if (n == 4 && memcmp(magic, zstd_magic, 4) == 0) {
+        format = INPUT_ZSTD;
+    }
+    rewind(fp);
+    if (format == INPUT_PLAIN) {
+        return fp;
+    }
+#ifndef HAVE_ZSTD
+    if (format == INPUT_ZSTD) {
+        fprintf(stderr, "Reading zstd input needs a build with HAVE_ZSTD.\n");
+        fclose(fp);
+        return NULL;
+    }
+#endif
+
+    r = calloc(1, sizeof(inflate_ring));
+    if (r == NULL) {
+        perror("calloc");
+        exit(1);
+    }
+    for (i = 0; i < RING_BLOCKS; i++) {
+        r->blocks[i] = malloc(RING_BLOCK_SIZE);
+        if (r->blocks[i] == NULL) {
+            perror("malloc");
+            exit(1);
+        }
+    }
+    r->src = fp;
+    r->format = format;
+    pthread_mutex_init(&r->lock, NULL);
+    pthread_cond_init(&r->not_empty, NULL);
+    pthread_cond_init(&r->not_full, NULL);
+    if (pthread_create(&r->thread, NULL, inflate_thread, r) != 0) {
+        fprintf(stderr, "Cannot create the decompressor thread\n");
+        exit(1);
+    }
+    stream = fopencookie(r, "r", io);
+    if (stream == NULL) {
+        perror("fopencookie");
+        exit(1);
+    }
+    return stream;
+}
+
 /*
  * Check if any prefixes in s1 equal any suffixes in s2.
  * Return an int representing the length of the longest overlap found.
@@ -256,8 +697,310 @@ void merge(char *a[], int i, int j, int n_overlap, int n_elems)
     a[i] = result;
 }
 
+/*
+ * The fragments packed into bits symbols per character, if the
+ * alphabet of the input is small enough, for the kernels below to
+ * compare a 64-bit word of symbols at a time. The text is kept as well,
+ * so that the packed form never has to be decoded.
+ */
+typedef struct {
+    int bits; // per symbol: 2, 4 or 5, or 0 if the fragments are not packed
+    int lanes; // whole symbols in a word
+    uint64_t ones; // the lowest bit of each lane
+    uint64_t high; // the highest bit of each lane
+    uint64_t low; // the other bits of each lane
+    unsigned char code[256]; // symbol of each character
+    uint64_t **words; // indexed like the fragments, NULL if not packed
+} packed_frags;
+
+/* Words of a packed fragment of len characters, one spare for windows */
+size_t packed_n_words(const packed_frags *pk, int len)
+{
+    return ((size_t)len * pk->bits + 63) / 64 + 1;
+}
+
+/* Pack fragment i, of length len, from the text s */
+void packed_set(packed_frags *pk, int i, const char *s, int len)
+{
+    uint64_t *w, c;
+    size_t bit = 0;
+    int k, r;
+
+    if (pk->bits == 0) {
+        return;
+    }
+    free(pk->words[i]);
+    w = calloc(packed_n_words(pk, len), sizeof(uint64_t));
+    if (w == NULL) {
+        perror("calloc");
+        exit(1);
+    }
+    for (k = 0; k < len; k++, bit += pk->bits) {
+        c = pk->code[(unsigned char)s[k]];
+        r = bit % 64;
+        w[bit / 64] |= c << r;
+        if (r + pk->bits > 64) {
+            w[bit / 64 + 1] |= c >> (64 - r);
+        }
+    }
+    pk->words[i] = w;
+}
+
+/*
+ * Choose the width of a symbol from the characters of the n_elems
+ * fragments of a, and pack them if it is at most 5 bits.
+ */
+void packed_init(packed_frags *pk, char *a[], int len[], int n_elems)
+{
+    int i, k, n_symbols = 0;
+    char seen[256] = {0};
+
+    memset(pk, 0, sizeof(*pk));
+    for (i = 0; i < n_elems; i++) {
+        for (k = 0; k < len[i]; k++) {
+            seen[(unsigned char)a[i][k]] = 1;
+        }
+    }
+    for (k = 0; k < 256; k++) {
+        if (seen[k]) {
+            pk->code[k] = n_symbols++;
+        }
+    }
+    pk->bits = n_symbols <= 4 ? 2 : n_symbols <= 16 ? 4 : n_symbols <= 32 ? 5 : 0;
+    if (pk->bits == 0) {
+        return;
+    }
+    pk->lanes = 64 / pk->bits;
+    for (k = 0; k < pk->lanes; k++) {
+        pk->ones |= 1ULL << (k * pk->bits);
+    }
+    pk->high = pk->ones << (pk->bits - 1);
+    pk->low = (pk->ones << pk->bits) - pk->ones - pk->high;
+    pk->words = calloc(n_elems, sizeof(uint64_t *));
+    if (pk->words == NULL) {
+        perror("calloc");
+        exit(1);
+    }
+    for (i = 0; i < n_elems; i++) {
+        packed_set(pk, i, a[i], len[i]);
+    }
+}
+
+/* Free the packed form of fragment i */
+void packed_drop(packed_frags *pk, int i)
+{
+    if (pk->bits != 0) {
+        free(pk->words[i]);
+        pk->words[i] = NULL;
+    }
+}
+
+/* Move the packed form of fragment src to dst, as the text is moved */
+void packed_move(packed_frags *pk, int dst, int src)
+{
+    if (pk->bits != 0 && dst != src) {
+        free(pk->words[dst]);
+        pk->words[dst] = pk->words[src];
+        pk->words[src] = NULL;
+    }
+}
+
+void packed_free(packed_frags *pk, int n_elems)
+{
+    int i;
+
+    for (i = 0; pk->bits != 0 && i < n_elems; i++) {
+        free(pk->words[i]);
+    }
+    free(pk->words);
+}
+
+/* The 64 bits of the packed fragment w starting at bit */
+static inline uint64_t packed_window(const uint64_t *w, size_t bit)
+{
+    int r = bit % 64;
+
+    if (r == 0) {
+        return w[bit / 64];
+    }
+    return w[bit / 64] >> r | w[bit / 64 + 1] << (64 - r);
+}
+
+/* Return 1 if the n_bits of w1 from bit equal the first n_bits of w2 */
+static inline int packed_equal(const uint64_t *w1, size_t bit,
+                               const uint64_t *w2, size_t n_bits)
+{
+    size_t k;
+
+    for (k = 0; k + 64 <= n_bits; k += 64) {
+        if (packed_window(w1, bit + k) != w2[k / 64]) {
+            return 0;
+        }
+    }
+    if (k < n_bits) {
+        return ((packed_window(w1, bit + k) ^ w2[k / 64]) &
+                ((1ULL << (n_bits - k)) - 1)) == 0;
+    }
+    return 1;
+}
+
+/* Return the highest bit of each lane of x that is zero */
+static inline uint64_t zero_lanes(const packed_frags *pk, uint64_t x)
+{
+    // A lane is not zero if its low bits carry into its high bit, or if
+    // its high bit is set already
+    return ~(((x & pk->low) + pk->low) | x) & pk->high;
+}
+
+/*
+ * Return the first position p from p0 to p1 where the packed fragment w,
+ * of len symbols, holds the first n symbols of needle, or the first
+ * len - p if n is 0. Return -1 if there is none.
+ * The lanes of a word of w that start like needle, on its first two
+ * symbols, are found at once, and only those positions are compared in
+ * full. A word then moves on by one lane less than it holds, since its
+ * last lane has no next lane in the word.
+ */
+int packed_search(const packed_frags *pk, const uint64_t *w, int len, int p0,
+                  int p1, const uint64_t *needle, int n)
+{
+    uint64_t x, hits, sym = (1ULL << pk->bits) - 1;
+    uint64_t first = (needle[0] & sym) * pk->ones;
+    uint64_t second = (needle[0] >> pk->bits & sym) * pk->ones;
+    int p, lane, last = p1;
+
+    if (n == 0 && last == len - 1) {
+        last--; // one symbol is left there, it is compared below
+    }
+    for (p = p0; p <= last; p += pk->lanes - 1) {
+        x = packed_window(w, (size_t)p * pk->bits);
+        hits = zero_lanes(pk, x ^ first);
+        if (n != 1) {
+            hits &= zero_lanes(pk, x ^ second) >> pk->bits;
+        }
+        while (hits != 0) {
+            lane = __builtin_ctzll(hits) / pk->bits;
+            if (p + lane > last) {
+                break;
+            }
+            if (packed_equal(w, (size_t)(p + lane) * pk->bits, needle,
+                             (size_t)(n > 0 ? n : len - p - lane) * pk->bits)) {
+                return p + lane;
+            }
+            hits &= hits - 1;
+        }
+    }
+    if (last < p1 && p1 >= p0 &&
+        (packed_window(w, (size_t)p1 * pk->bits) & sym) == (needle[0] & sym)) {
+        return p1;
+    }
+    return -1;
+}
+
+/* Return the position of the first occurrence of fragment j in i, or -1 */
+int packed_find(const packed_frags *pk, int len[], int i, int j)
+{
+    return packed_search(pk, pk->words[i], len[i], 0, len[i] - len[j],
+                         pk->words[j], len[j]);
+}
+
+/*
+ * Return the length of the longest prefix of fragment i that is also a
+ * suffix of fragment j, as n_prefix_suffix_overlap does.
+ */
+int packed_overlap(const packed_frags *pk, int len[], int i, int j)
+{
+    int p, n_max = len[i] < len[j] ? len[i] : len[j];
+
+    p = packed_search(pk, pk->words[j], len[j], len[j] - n_max, len[j] - 1,
+                      pk->words[i], 0);
+    return p < 0 ? 0 : len[j] - p;
+}
+
+/*
+ * Return the position of the first occurrence of a[j] in a[i], or -1,
+ * comparing packed symbols if the fragments are packed.
+ */
+int frag_find(char *a[], int len[], const packed_frags *pk, int i, int j)
+{
+    char *s;
+
+    if (len[j] > len[i]) {
+        return -1;
+    }
+    if (pk->bits != 0) {
+        return packed_find(pk, len, i, j);
+    }
+    s = strstr(a[i], a[j]);
+    return s != NULL ? (int)(s - a[i]) : -1;
+}
+
+/* Return n_prefix_suffix_overlap(a[i], a[j]), packed if possible */
+int frag_overlap(char *a[], int len[], const packed_frags *pk, int i, int j)
+{
+    if (pk->bits != 0) {
+        return packed_overlap(pk, len, i, j);
+    }
+    return n_prefix_suffix_overlap(a[i], a[j]);
+}
+
+/* An entry of the length index */
+typedef struct {
+    int len;
+    int index; // position of the fragment in the array
+} frag_key;
+
+/* Order the length index longest first, ties by position */
+int cmp_frag_key(const void *p1, const void *p2)
+{
+    const frag_key *k1 = p1;
+    const frag_key *k2 = p2;
+
+    if (k1->len != k2->len) {
+        return k2->len - k1->len;
+    }
+    return k1->index - k2->index;
+}
+
+/* Remove the entry of the fragment at index from the length index */
+void index_remove(frag_key keys[], int n_keys, int index)
+{
+    int k;
+
+    for (k = 0; keys[k].index != index; k++) {
+        assert(k < n_keys - 1);
+    }
+    memmove(&keys[k], &keys[k + 1], (n_keys - k - 1) * sizeof(frag_key));
+}
+
+/* Insert the entry of the fragment at index into the length index */
+void index_insert(frag_key keys[], int n_keys, int len[], int index)
+{
+    int k;
+    frag_key key = {len[index], index};
+
+    for (k = n_keys; k > 0 && cmp_frag_key(&keys[k - 1], &key) > 0; k--) {
+        keys[k] = keys[k - 1];
+    }
+    keys[k] = key;
+}
+
+/*
+ * Return 1 if an overlap of n_overlap for the pair (i, j) beats the best
+ * pair so far: it is longer, or as long and (i, j) comes first.
+ */
+int beats(int n_overlap, int i, int j, int max_overlap, int i_save, int j_save)
+{
+    if (n_overlap != max_overlap) {
+        return n_overlap > max_overlap;
+    }
+    return i < i_save || (i == i_save && j < j_save);
+}
+
 /*
  * The logical length of the array is n_elems.
+ * len holds the length of each fragment, keys the length index and pk
+ * the packed fragments.
  * Examine all pairs of fragments in the array to find
  * the pair (i_save, j_save) with the maximal overlap.
  * Update a[i_save] to point to the merged string.
@@ -266,26 +1009,33 @@ void merge(char *a[], int i, int j, int n_overlap, int n_elems)
  * Decrease the logical length of the array by 1.
  * Return the new logical length of the array.
  */
-int reassemble_pass(char *a[], int n_elems)
+int reassemble_pass(char *a[], int len[], frag_key keys[], packed_frags *pk,
+                    int n_elems)
 {
-    char *s;
-    int i, j; 
+    int i, j, k, kept, pos;
     int i_save = -1, j_save = -1;
-    int curr_overlap;
+    int curr_overlap, bound;
     int max_overlap = -1;
     int contained_flag = 0;
 
-    // Search through all pairs of frags
-    for (i = 0; i < n_elems; i++) {
+    // Search through the pairs of frags, longest a[i] first
+    for (k = 0; k < n_elems; k++) {
+        i = keys[k].index;
+        if (len[i] < max_overlap) {
+            break; // no later row is longer
+        }
+        if (!beats(len[i], i, 0, max_overlap, i_save, j_save)) {
+            continue; // a tie at best, and the pair saved comes first
+        }
         for (j = 0; j < n_elems; j++) {
             if (i == j) {
                 continue;
             }
             // Check if a[j] is contained in a[i]
-            s = strstr(a[i], a[j]);
-            if (s != NULL) {
-                curr_overlap = strlen(s);
-                if (curr_overlap > max_overlap) {
+            pos = frag_find(a, len, pk, i, j);
+            if (pos >= 0) {
+                curr_overlap = len[i] - pos;
+                if (beats(curr_overlap, i, j, max_overlap, i_save, j_save)) {
                     max_overlap = curr_overlap;
                     i_save = i;
                     j_save = j;
@@ -293,9 +1043,13 @@ int reassemble_pass(char *a[], int n_elems)
                 }
                 continue; // no need to check for prefix/suffix overlap
             }
+            bound = len[i] < len[j] ? len[i] : len[j];
+            if (!beats(bound, i, j, max_overlap, i_save, j_save)) {
+                continue;
+            }
             // Check for the longest a[i] prefix that is also an a[j] suffix
-            curr_overlap = n_prefix_suffix_overlap(a[i], a[j]);
-            if (curr_overlap > max_overlap) {
+            curr_overlap = frag_overlap(a, len, pk, i, j);
+            if (beats(curr_overlap, i, j, max_overlap, i_save, j_save)) {
                 max_overlap = curr_overlap;
                 i_save = i;
                 j_save = j;
@@ -309,62 +1063,2639 @@ int reassemble_pass(char *a[], int n_elems)
 
     if (!contained_flag) {
         merge(a, i_save, j_save, max_overlap, n_elems);
+        len[i_save] += len[j_save] - max_overlap;
+        packed_set(pk, i_save, a[i_save], len[i_save]);
     }
+    // Take the fragments that change position or length out of the index
+    index_remove(keys, n_elems, i_save);
+    index_remove(keys, n_elems - 1, j_save);
+    if (i_save != n_elems - 1 && j_save != n_elems - 1) {
+        index_remove(keys, n_elems - 2, n_elems - 1);
+    }
+    kept = i_save == n_elems - 1 ? j_save : i_save;
+
     // a[i_save] points to the fragment to keep
     // a[j_save] can be overwritten with the last fragment
     free(a[j_save]);
     a[j_save] = a[n_elems - 1];
+    len[j_save] = len[n_elems - 1];
+    packed_drop(pk, j_save);
+    packed_move(pk, j_save, n_elems - 1);
     a[n_elems - 1] = NULL;
     n_elems--;
+
+    if (i_save != n_elems && j_save != n_elems) {
+        index_insert(keys, n_elems - 2, len, j_save);
+        index_insert(keys, n_elems - 1, len, kept);
+    }
+    else {
+        index_insert(keys, n_elems - 1, len, kept);
+    }
     return n_elems;
 }
 
-/* Continue to call reassemble_pass until there is a one fragment in the array */
-void reassemble(char *a[], int n_frags)
+/* splitmix64 finalizer */
+uint64_t mix64(uint64_t x)
 {
-    while (n_frags > 1) {
-        n_frags = reassemble_pass(a, n_frags);
-    }
+    x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    x = (x ^ (x >> 27)) * 0x94d049bb133111ebULL;
+    return x ^ (x >> 31);
 }
 
-/*
- * Use the command-line argument as a file path.
- * Open and read all fragments from that file.
- * On error, close the file and exit.
- * Print the assembled solution to the console.
- */
-int main(int argc, char *argv[])
+double now_seconds(void)
 {
-    char *filename;
-    char *frags[MAX_FRAG_COUNT];
-    FILE *fp;
-    int n_frags;
+    struct timespec ts;
 
-    if (argc == 1) {
-        fprintf(stderr, "You must specify a filename argument.\n");
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static const char checkpoint_magic[8] = "RASMCKP";
+
+/*
+ * The header of a checkpoint file. It is followed by the length of each
+ * fragment as a uint32_t, then by the fragments without their '\0', then,
+ * if has_matrix is set, by the n_frags x n_frags overlap matrix of tiled
+ * mode.
+ */
+typedef struct {
+    char magic[8];
+    uint32_t version;
+    uint32_t n_frags;
+    uint64_t input_hash; // of the fragments that were read
+    uint32_t has_matrix;
+    uint32_t reserved;
+} checkpoint_header;
+
+enum {
+    CHECKPOINT_VERSION = 1,
+};
+
+/* The time budget and the checkpoints of a reassembly */
+typedef struct {
+    double deadline; // 0 if there is no time budget
+    const char *checkpoint; // NULL if there is no checkpoint file
+    double next_checkpoint;
+    uint64_t input_hash;
+    uint16_t *resume_matrix; // overlaps loaded from the checkpoint, or NULL
+} run_ctl;
+
+/* Hash the fragments, so that a checkpoint is only resumed on its input */
+uint64_t hash_frags(char *a[], int n_elems)
+{
+    uint64_t h = 0xcbf29ce484222325ULL; // FNV-1a
+    const unsigned char *c;
+    int i;
+
+    for (i = 0; i < n_elems; i++) {
+        for (c = (const unsigned char *)a[i]; *c != '\0'; c++) {
+            h = (h ^ *c) * 0x100000001b3ULL;
+        }
+        h = mix64(h ^ i);
+    }
+    return h;
+}
+
+/*
+ * Write the n_elems fragments of a, and the overlap matrix m of row
+ * length stride unless it is NULL, to the checkpoint file. The file is
+ * written under a temporary name and renamed, so that a run killed while
+ * writing leaves the previous checkpoint whole.
+ * Return -1 on an I/O error, which is reported but not fatal.
+ */
+int save_checkpoint(const run_ctl *ctl, char *a[], int n_elems,
+                    const uint16_t m[], int stride)
+{
+    checkpoint_header header;
+    char tmp_path[strlen(ctl->checkpoint) + sizeof(".tmp")];
+    uint32_t n;
+    FILE *fp;
+    int i, ok;
+
+    sprintf(tmp_path, "%s.tmp", ctl->checkpoint);
+    fp = fopen(tmp_path, "wb");
+    if (fp == NULL) {
+        perror(tmp_path);
+        return -1;
+    }
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, checkpoint_magic, sizeof(header.magic));
+    header.version = CHECKPOINT_VERSION;
+    header.n_frags = n_elems;
+    header.input_hash = ctl->input_hash;
+    header.has_matrix = m != NULL;
+    ok = fwrite(&header, sizeof(header), 1, fp) == 1;
+    for (i = 0; i < n_elems && ok; i++) {
+        n = strlen(a[i]);
+        ok = fwrite(&n, sizeof(n), 1, fp) == 1;
+    }
+    for (i = 0; i < n_elems && ok; i++) {
+        ok = fwrite(a[i], 1, strlen(a[i]), fp) == strlen(a[i]);
+    }
+    for (i = 0; i < n_elems && m != NULL && ok; i++) {
+        ok = fwrite(&m[(size_t)i * stride], sizeof(uint16_t), n_elems, fp) ==
+             (size_t)n_elems;
+    }
+    if (fclose(fp) != 0) {
+        ok = 0;
+    }
+    if (!ok || rename(tmp_path, ctl->checkpoint) != 0) {
+        perror(ctl->checkpoint);
+        remove(tmp_path);
+        return -1;
+    }
+    return 0;
+}
+
+/*
+ * Replace the n_elems fragments of a, just read from the input, by the
+ * fragments of the checkpoint file, and load its overlap matrix, if any,
+ * into ctl->resume_matrix.
+ * Return the number of fragments, or -1 if the file is not a checkpoint
+ * of this input.
+ */
+int load_checkpoint(run_ctl *ctl, char *a[], int n_elems)
+{
+    checkpoint_header header;
+    struct stat sb;
+    uint32_t *len = NULL;
+    uint64_t rest, total = 0;
+    char **loaded;
+    FILE *fp;
+    int i, ok;
+    size_t n_matrix;
+
+    fp = fopen(ctl->checkpoint, "rb");
+    if (fp == NULL) {
+        perror(ctl->checkpoint);
+        return -1;
+    }
+    ok = fread(&header, sizeof(header), 1, fp) == 1 &&
+         memcmp(header.magic, checkpoint_magic, sizeof(header.magic)) == 0 &&
+         header.version == CHECKPOINT_VERSION &&
+         header.input_hash == ctl->input_hash &&
+         header.n_frags >= 1 && header.n_frags <= (uint32_t)n_elems;
+    if (!ok) {
+        fprintf(stderr, "\"%s\" is not a checkpoint of this input.\n",
+                ctl->checkpoint);
+        fclose(fp);
+        return -1;
+    }
+    // The lengths must add up to the size of the file, so that a corrupt
+    // one is caught before anything is allocated for it
+    n_matrix = header.has_matrix ? (size_t)header.n_frags * header.n_frags : 0;
+    rest = sizeof(header) + header.n_frags * sizeof(uint32_t) +
+           n_matrix * sizeof(uint16_t);
+    ok = fstat(fileno(fp), &sb) == 0 && (uint64_t)sb.st_size > rest;
+    if (ok) {
+        len = malloc(header.n_frags * sizeof(uint32_t));
+        if (len == NULL) {
+            perror("malloc");
+            exit(1);
+        }
+        ok = fread(len, sizeof(uint32_t), header.n_frags, fp) == header.n_frags;
+    }
+    for (i = 0; i < (int)header.n_frags && ok; i++) {
+        ok = len[i] > 0;
+        total += len[i];
+    }
+    if (!ok || total != (uint64_t)sb.st_size - rest) {
+        fprintf(stderr, "Checkpoint \"%s\" is truncated.\n", ctl->checkpoint);
+        fclose(fp);
+        free(len);
+        return -1;
+    }
+    loaded = calloc(header.n_frags, sizeof(char *));
+    ctl->resume_matrix = n_matrix > 0 ? malloc(n_matrix * sizeof(uint16_t)) : NULL;
+    if (loaded == NULL || (n_matrix > 0 && ctl->resume_matrix == NULL)) {
+        perror("malloc");
+        exit(1);
+    }
+    for (i = 0; i < (int)header.n_frags && ok; i++) {
+        loaded[i] = malloc(len[i] + 1);
+        if (loaded[i] == NULL) {
+            perror("malloc");
+            exit(1);
+        }
+        ok = fread(loaded[i], 1, len[i], fp) == len[i];
+        loaded[i][len[i]] = '\0';
+        ok = ok && strlen(loaded[i]) == len[i];
+    }
+    if (ok && n_matrix > 0) {
+        ok = fread(ctl->resume_matrix, sizeof(uint16_t), n_matrix, fp) == n_matrix;
+    }
+    fclose(fp);
+    if (!ok) {
+        fprintf(stderr, "Checkpoint \"%s\" is truncated.\n", ctl->checkpoint);
+        free_all_memory(loaded, header.n_frags);
+        free(ctl->resume_matrix);
+        ctl->resume_matrix = NULL;
+    }
+    else {
+        free_all_memory(a, n_elems);
+        memcpy(a, loaded, header.n_frags * sizeof(char *));
+        fprintf(stderr, "Resuming from checkpoint \"%s\" with %u fragments\n",
+                ctl->checkpoint, header.n_frags);
+    }
+    free(loaded);
+    free(len);
+    return ok ? (int)header.n_frags : -1;
+}
+
+/*
+ * Called between passes with the current fragments, and the overlap
+ * matrix if there is one. Write a checkpoint if one is due.
+ * Return 1 if the time budget has run out, after writing a checkpoint.
+ */
+int ctl_stop(run_ctl *ctl, char *a[], int n_elems, const uint16_t m[],
+             int stride)
+{
+    double now;
+    int expired;
+
+    if (ctl == NULL) {
+        return 0;
+    }
+    now = now_seconds();
+    expired = ctl->deadline > 0 && now >= ctl->deadline;
+    if (ctl->checkpoint != NULL && (expired || now >= ctl->next_checkpoint)) {
+        save_checkpoint(ctl, a, n_elems, m, stride);
+        ctl->next_checkpoint = now + CHECKPOINT_INTERVAL;
+    }
+    return expired;
+}
+
+/*
+ * Concatenate the n_elems contigs of a, in order, into a[0]: the best
+ * partial assembly when time runs out.
+ */
+void concat_contigs(char *a[], int n_elems)
+{
+    char *result;
+    size_t total = 1;
+    int i;
+
+    for (i = 0; i < n_elems; i++) {
+        total += strlen(a[i]);
+    }
+    result = malloc(total);
+    if (result == NULL) {
+        perror("malloc");
+        exit(1);
+    }
+    total = 0;
+    for (i = 0; i < n_elems; i++) {
+        strcpy(result + total, a[i]);
+        total += strlen(a[i]);
+    }
+    free_all_memory(a, n_elems);
+    a[0] = result;
+}
+
+/*
+ * Continue to call reassemble_pass until there is a one fragment in the
+ * array, or until ctl, unless it is NULL, says to stop.
+ * Return the number of fragments left.
+ */
+int reassemble_until(char *a[], int n_frags, run_ctl *ctl)
+{
+    int i, n_start = n_frags;
+    int len[MAX_FRAG_COUNT];
+    frag_key keys[MAX_FRAG_COUNT];
+    packed_frags pk;
+
+    for (i = 0; i < n_frags; i++) {
+        len[i] = strlen(a[i]);
+        keys[i].len = len[i];
+        keys[i].index = i;
+    }
+    qsort(keys, n_frags, sizeof(frag_key), cmp_frag_key);
+    packed_init(&pk, a, len, n_frags);
+    while (n_frags > 1 && !ctl_stop(ctl, a, n_frags, NULL, 0)) {
+        n_frags = reassemble_pass(a, len, keys, &pk, n_frags);
+    }
+    packed_free(&pk, n_start);
+    return n_frags;
+}
+
+/* Continue to call reassemble_pass until there is a one fragment in the array */
+void reassemble(char *a[], int n_frags)
+{
+    reassemble_until(a, n_frags, NULL);
+}
+
+/* An occurrence of a minimizer in a fragment */
+typedef struct {
+    uint64_t hash;
+    int frag;
+    int pos;
+    int next; // next entry with the same hash bucket, or -1
+} seed_entry;
+
+/* A verified overlap: y starts about offset characters into x */
+typedef struct {
+    int score; // characters of y in the overlap, all of them if x contains y
+    int x;
+    int y;
+    int offset;
+    int contained;
+} overlap_edge;
+
+/* The state of an approximate reassembly */
+typedef struct {
+    char **frags; // indexed by fragment id, NULL once merged away
+    int *len;
+    int n_ids;
+    int max_mismatches;
+    int *heads; // hash bucket -> first seed_entry, or -1
+    int n_heads; // a power of two
+    seed_entry *entries;
+    int n_entries, entries_cap;
+    overlap_edge *heap; // max heap on score
+    int n_edges, heap_cap;
+} approx_state;
+
+/* Grow the array at *p of elements of size elem_size to hold n more */
+void reserve(void *p, int *cap, int n, size_t elem_size)
+{
+    void **arr = p;
+
+    if (n <= *cap) {
+        return;
+    }
+    *cap = *cap * 2 > n ? *cap * 2 : n;
+    *arr = realloc(*arr, *cap * elem_size);
+    if (*arr == NULL) {
+        perror("realloc");
+        exit(1);
+    }
+}
+
+/*
+ * Return a mask with bit r set if p[lo + r] is c, for r < w, comparing
+ * eight characters at a time. Positions before p count as matches, and
+ * positions at or past p_len as mismatches.
+ */
+static inline uint64_t match_mask(const char *p, int p_len, int lo, int w,
+                                  char c)
+{
+    const uint64_t low7 = 0x7f7f7f7f7f7f7f7fULL;
+    uint64_t x, mask = 0;
+    int r = 0;
+
+    for (; r < w && lo + r < 0; r++) {
+        mask |= 1ULL << r;
+    }
+    for (; r < w && lo + r + 8 <= p_len; r += 8) {
+        memcpy(&x, p + lo + r, 8);
+        x ^= 0x0101010101010101ULL * (unsigned char)c;
+        // The high bit of each byte of x is set if that byte is zero
+        x = ~(((x & low7) + low7) | x) & ~low7;
+        // Gather the eight high bits, byte i to bit i
+        mask |= ((x >> 7) * 0x0102040810204080ULL >> 56) << r;
+    }
+    for (; r < w && lo + r < p_len; r++) {
+        mask |= (uint64_t)(p[lo + r] == c) << r;
+    }
+    return w < 64 ? mask & ((1ULL << w) - 1) : mask;
+}
+
+/*
+ * Return the fewest edits aligning the first p_len characters of p with
+ * the t_len characters of t, on the diagonals within band of the one
+ * that puts p[0] against t[d0], with 0 <= d0 <= band <= MAX_APPROX_BAND.
+ * The alignment may start anywhere on t. If contained, it must use all
+ * of p, and may end anywhere on t; otherwise it must use all of t, may
+ * end anywhere on p, and *used is set to the characters of p it uses.
+ * Return limit + 1 as soon as more than limit edits are certain.
+ *
+ * This is the bit-vector algorithm of Myers, with the band of Hyyro: bit
+ * r of vp and vn says whether the cell of row top_row + r is one more or
+ * one less than the cell above it, and the band moves down one row per
+ * column of t. Rows above row 0 cost nothing, as the start is free, and
+ * cells outside the band count as one more than their in-band neighbor.
+ */
+int banded_edits(const char *p, int p_len, const char *t, int t_len, int d0,
+                 int band, int limit, int contained, int *used)
+{
+    const int w = 2 * band + 1;
+    const uint64_t all = (1ULL << w) - 1, bottom = 1ULL << (w - 1);
+    uint64_t vp, vn, eq, xv, xh, hp, hn, below;
+    int j, r, i, top_row, top = 0, d, best = limit + 1, best_i = 0;
+
+    // Column 0: row i costs i deletions
+    top_row = -d0 - band;
+    vp = top_row >= 0 ? all : all & ~((2ULL << -top_row) - 1);
+    vn = 0;
+    if (contained && p_len - top_row < w) {
+        best = p_len;
+    }
+    for (j = 1; j <= t_len && best > 0; j++) {
+        // Move the band down, the new row costing one more than the last
+        vp = (vp >> 1) | bottom;
+        vn >>= 1;
+        top += (int)(vp & 1) - (int)(vn & 1);
+        top_row++;
+        eq = match_mask(p, p_len, top_row - 1, w, t[j - 1]);
+        xv = eq | vn;
+        xh = (((eq & vp) + vp) ^ vp) | eq;
+        hp = vn | ~(xh | vp);
+        hn = vp & xh;
+        top += (int)(hp & 1) - (int)(hn & 1);
+        // The row above the band is free at row 0, else one more
+        hp = (hp << 1) | (top_row > 1);
+        hn <<= 1;
+        vp = (hn | ~(xv | hp)) & all;
+        vn = hp & xv & all;
+        if (top > limit && top - __builtin_popcountll(vn) > limit) {
+            return contained && best <= limit ? best : limit + 1;
+        }
+        r = p_len - top_row;
+        if (contained && r >= 0 && r < w) {
+            below = (2ULL << r) - 2;
+            d = top + __builtin_popcountll(vp & below) -
+                __builtin_popcountll(vn & below);
+            best = d < best ? d : best;
+        }
+        else if (contained && r < 0) {
+            break; // row p_len has left the band
+        }
+    }
+    if (contained) {
+        return best;
+    }
+    // Every row of the last column ends an alignment; prefer the one
+    // nearest the diagonal of d0 among the fewest edits
+    d = top;
+    for (r = 0; r < w; r++) {
+        i = top_row + r;
+        if (r > 0) {
+            d += (int)(vp >> r & 1) - (int)(vn >> r & 1);
+        }
+        if (i < 1 || i > p_len) {
+            continue;
+        }
+        if (d < best || (d == best && abs(i - (t_len - d0)) <
+                                      abs(best_i - (t_len - d0)))) {
+            best = d;
+            best_i = i;
+        }
+    }
+    *used = best_i;
+    return best;
+}
+
+/*
+ * Store the minimizers of the string s of length n in hashes and
+ * positions, which must have room for n entries. Return their number.
+ */
+int find_minimizers(const char *s, int n, uint64_t hashes[], int positions[])
+{
+    int i, p, w, n_seeds, n_out = 0, best;
+    uint64_t h;
+
+    n_seeds = n - SEED_LEN + 1;
+    if (n_seeds <= 0) {
+        return 0;
+    }
+    // Hash every seed, in place in hashes
+    for (p = 0; p < n_seeds; p++) {
+        h = 0;
+        for (i = 0; i < SEED_LEN; i++) {
+            h = h * 131 + (unsigned char)s[p + i];
+        }
+        hashes[p] = mix64(h);
+    }
+    w = n_seeds < SEED_WINDOW ? n_seeds : SEED_WINDOW;
+    for (p = 0; p + w <= n_seeds; p++) {
+        best = p;
+        for (i = p + 1; i < p + w; i++) {
+            if (hashes[i] < hashes[best]) {
+                best = i;
+            }
+        }
+        if (n_out == 0 || positions[n_out - 1] != best) {
+            positions[n_out++] = best; // hashes[best] is read below
+        }
+    }
+    // Compact the chosen hashes, which never move left of their seed
+    for (i = 0; i < n_out; i++) {
+        hashes[i] = hashes[positions[i]];
+    }
+    return n_out;
+}
+
+/* Order edges by score, then by fragment ids */
+int edge_before(const overlap_edge *e1, const overlap_edge *e2)
+{
+    if (e1->score != e2->score) {
+        return e1->score > e2->score;
+    }
+    if (e1->x != e2->x) {
+        return e1->x < e2->x;
+    }
+    return e1->y < e2->y;
+}
+
+void heap_push(approx_state *st, overlap_edge e)
+{
+    int c, parent;
+    overlap_edge tmp;
+
+    reserve(&st->heap, &st->heap_cap, st->n_edges + 1, sizeof(overlap_edge));
+    c = st->n_edges++;
+    st->heap[c] = e;
+    while (c > 0) {
+        parent = (c - 1) / 2;
+        if (!edge_before(&st->heap[c], &st->heap[parent])) {
+            break;
+        }
+        tmp = st->heap[c];
+        st->heap[c] = st->heap[parent];
+        st->heap[parent] = tmp;
+        c = parent;
+    }
+}
+
+overlap_edge heap_pop(approx_state *st)
+{
+    int c = 0, child;
+    overlap_edge top = st->heap[0], tmp;
+
+    st->heap[0] = st->heap[--st->n_edges];
+    while ((child = 2 * c + 1) < st->n_edges) {
+        if (child + 1 < st->n_edges &&
+            edge_before(&st->heap[child + 1], &st->heap[child])) {
+            child++;
+        }
+        if (!edge_before(&st->heap[child], &st->heap[c])) {
+            break;
+        }
+        tmp = st->heap[c];
+        st->heap[c] = st->heap[child];
+        st->heap[child] = tmp;
+        c = child;
+    }
+    return top;
+}
+
+/*
+ * Check whether fragment y, placed about offset characters into fragment
+ * x, overlaps it with at most max_mismatches edits: substitutions, or
+ * insertions and deletions that shift the alignment by at most
+ * MAX_APPROX_BAND from offset. If so, push the overlap onto the heap,
+ * scored by the characters of y it covers.
+ */
+void verify_candidate(approx_state *st, int x, int y, int offset)
+{
+    overlap_edge e;
+    int n_overlap, tmp, band, start, t_len, p_len, used;
+
+    if (offset < 0) {
+        tmp = x;
+        x = y;
+        y = tmp;
+        offset = -offset;
+    }
+    if (offset >= st->len[x]) {
+        return;
+    }
+    n_overlap = st->len[x] - offset;
+    e.x = x;
+    e.y = y;
+    e.offset = offset;
+    e.contained = n_overlap >= st->len[y];
+    if (!e.contained && n_overlap < MIN_APPROX_OVERLAP) {
+        return;
+    }
+    band = st->max_mismatches < MAX_APPROX_BAND ? st->max_mismatches :
+                                                  MAX_APPROX_BAND;
+    start = offset > band ? offset - band : 0;
+    t_len = st->len[x] - start;
+    if (e.contained) {
+        // y may end anywhere in x within the band
+        p_len = used = st->len[y];
+        if (t_len > offset - start + p_len + band) {
+            t_len = offset - start + p_len + band;
+        }
+    }
+    else {
+        // The end of x may fall anywhere in y within the band
+        p_len = n_overlap + band < st->len[y] ? n_overlap + band : st->len[y];
+    }
+    if (banded_edits(st->frags[y], p_len, st->frags[x] + start, t_len,
+                     offset - start, band, st->max_mismatches, e.contained,
+                     &used) > st->max_mismatches ||
+        (!e.contained && used < MIN_APPROX_OVERLAP)) {
+        return;
+    }
+    e.score = used;
+    heap_push(st, e);
+}
+
+/* Order candidates by fragment, then by offset */
+int cmp_candidate(const void *p1, const void *p2)
+{
+    const int *c1 = p1;
+    const int *c2 = p2;
+
+    if (c1[0] != c2[0]) {
+        return c1[0] - c2[0];
+    }
+    return c1[1] - c2[1];
+}
+
+/*
+ * Seed fragment id: find the fragments sharing a minimizer with it,
+ * verify each distinct alignment, and add its minimizers to the index.
+ */
+void approx_add(approx_state *st, int id)
+{
+    uint64_t *hashes;
+    int *positions, *candidates = NULL;
+    int i, e, hits, bucket, n_min, n_cand = 0, cand_cap = 0;
+    seed_entry *entry;
+
+    hashes = malloc((st->len[id] + 1) * sizeof(uint64_t));
+    positions = malloc((st->len[id] + 1) * sizeof(int));
+    if (hashes == NULL || positions == NULL) {
+        perror("malloc");
+        exit(1);
+    }
+    n_min = find_minimizers(st->frags[id], st->len[id], hashes, positions);
+
+    // Gather (fragment, offset of id in it) for every shared minimizer
+    for (i = 0; i < n_min; i++) {
+        bucket = hashes[i] & (st->n_heads - 1);
+        for (e = st->heads[bucket], hits = 0; e >= 0 && hits < MAX_SEED_HITS;
+             e = st->entries[e].next) {
+            entry = &st->entries[e];
+            if (entry->hash != hashes[i] || st->frags[entry->frag] == NULL) {
+                continue;
+            }
+            hits++;
+            reserve(&candidates, &cand_cap, 2 * (n_cand + 1), sizeof(int));
+            candidates[2 * n_cand] = entry->frag;
+            candidates[2 * n_cand + 1] = entry->pos - positions[i];
+            n_cand++;
+        }
+    }
+    if (n_cand > 1) {
+        qsort(candidates, n_cand, 2 * sizeof(int), cmp_candidate);
+    }
+    for (i = 0; i < n_cand; i++) {
+        if (i > 0 && candidates[2 * i] == candidates[2 * i - 2] &&
+            candidates[2 * i + 1] == candidates[2 * i - 1]) {
+            continue; // same alignment, already verified
+        }
+        verify_candidate(st, candidates[2 * i], id, candidates[2 * i + 1]);
+    }
+
+    reserve(&st->entries, &st->entries_cap, st->n_entries + n_min,
+            sizeof(seed_entry));
+    for (i = 0; i < n_min; i++) {
+        bucket = hashes[i] & (st->n_heads - 1);
+        entry = &st->entries[st->n_entries];
+        entry->hash = hashes[i];
+        entry->frag = id;
+        entry->pos = positions[i];
+        entry->next = st->heads[bucket];
+        st->heads[bucket] = st->n_entries++;
+    }
+    free(candidates);
+    free(positions);
+    free(hashes);
+}
+
+/*
+ * Apply the overlap e: drop y if x contains it, else replace both by a
+ * new fragment, x followed by the part of y past the overlap.
+ */
+void approx_merge(approx_state *st, const overlap_edge *e)
+{
+    char *result;
+    int id;
+
+    if (e->contained) {
+        free(st->frags[e->y]);
+        st->frags[e->y] = NULL;
+        return;
+    }
+    id = st->n_ids++;
+    st->len[id] = st->len[e->x] + st->len[e->y] - e->score;
+    result = malloc(st->len[id] + 1);
+    if (result == NULL) {
+        perror("malloc");
+        exit(1);
+    }
+    strcpy(result, st->frags[e->x]);
+    strcpy(result + st->len[e->x], st->frags[e->y] + e->score);
+    st->frags[id] = result;
+    free(st->frags[e->x]);
+    free(st->frags[e->y]);
+    st->frags[e->x] = NULL;
+    st->frags[e->y] = NULL;
+    approx_add(st, id);
+}
+
+/*
+ * Merge the n_frags fragments of a along approximate overlaps with at
+ * most max_mismatches mismatches, then reassemble the rest exactly.
+ * On return a[0] holds the result.
+ */
+void reassemble_approx(char *a[], int n_frags, int max_mismatches)
+{
+    approx_state st;
+    overlap_edge e;
+    int i, n_left, total_len = 0;
+
+    memset(&st, 0, sizeof(st));
+    st.max_mismatches = max_mismatches;
+    // Every merge creates one fragment id
+    st.frags = malloc(2 * n_frags * sizeof(char *));
+    st.len = malloc(2 * n_frags * sizeof(int));
+    if (st.frags == NULL || st.len == NULL) {
+        perror("malloc");
+        exit(1);
+    }
+    for (i = 0; i < n_frags; i++) {
+        st.frags[i] = a[i];
+        st.len[i] = strlen(a[i]);
+        total_len += st.len[i];
+    }
+    st.n_heads = 1024;
+    while (st.n_heads < total_len / 4) {
+        st.n_heads *= 2;
+    }
+    st.heads = malloc(st.n_heads * sizeof(int));
+    if (st.heads == NULL) {
+        perror("malloc");
+        exit(1);
+    }
+    memset(st.heads, -1, st.n_heads * sizeof(int));
+
+    for (i = 0; i < n_frags; i++) {
+        st.n_ids++;
+        approx_add(&st, i);
+    }
+    while (st.n_edges > 0) {
+        e = heap_pop(&st);
+        if (st.frags[e.x] != NULL && st.frags[e.y] != NULL) {
+            approx_merge(&st, &e);
+        }
+    }
+
+    n_left = 0;
+    for (i = 0; i < st.n_ids; i++) {
+        if (st.frags[i] != NULL) {
+            a[n_left++] = st.frags[i];
+        }
+    }
+    free(st.heap);
+    free(st.entries);
+    free(st.heads);
+    free(st.len);
+    free(st.frags);
+    reassemble(a, n_left);
+}
+
+/*
+ * The overlap of the pair (i, j) as reassemble_pass scores it, as an
+ * entry of the tiled matrix: the length, with OVERLAP_CONTAINED set if
+ * a[j] is contained in a[i].
+ */
+uint16_t pair_overlap(char *a[], int len[], const packed_frags *pk, int i,
+                      int j)
+{
+    int pos;
+
+    pos = frag_find(a, len, pk, i, j);
+    if (pos >= 0) {
+        return (len[i] - pos) | OVERLAP_CONTAINED;
+    }
+    return frag_overlap(a, len, pk, i, j);
+}
+
+/* Return the number of fragments per block of a tile */
+int tile_size(int len[], int n_elems)
+{
+    int i, tile;
+    size_t total_len = 0;
+
+    for (i = 0; i < n_elems; i++) {
+        total_len += len[i];
+    }
+    tile = TILE_CACHE_BYTES / (2 * (total_len / n_elems + 1));
+    // The tile of the matrix must fit as well
+    while (tile > 1 && (size_t)tile * tile * sizeof(uint16_t) > TILE_CACHE_BYTES) {
+        tile /= 2;
+    }
+    if (tile < 1) {
+        tile = 1;
+    }
+    return tile;
+}
+
+/*
+ * Fill the row of tiles starting at row r0, reporting each tile to
+ * report unless it is NULL.
+ */
+void fill_tile_row(char *a[], int len[], const packed_frags *pk, uint16_t m[],
+                   int stride, int n_elems, int r0, int tile, FILE *report)
+{
+    int i, j, c0, r1, c1, n_pairs;
+    size_t text_bytes;
+    double start;
+
+    r1 = r0 + tile < n_elems ? r0 + tile : n_elems;
+    for (c0 = 0; c0 < n_elems; c0 += tile) {
+        c1 = c0 + tile < n_elems ? c0 + tile : n_elems;
+        start = now_seconds();
+        text_bytes = 0;
+        for (i = r0; i < r1; i++) {
+            text_bytes += len[i] + 1;
+        }
+        for (j = c0; j < c1 && c0 != r0; j++) {
+            text_bytes += len[j] + 1;
+        }
+        n_pairs = 0;
+        for (i = r0; i < r1; i++) {
+            for (j = c0; j < c1; j++) {
+                if (i != j) {
+                    m[i * stride + j] = pair_overlap(a, len, pk, i, j);
+                    n_pairs++;
+                }
+            }
+        }
+        if (report != NULL) {
+            fprintf(report, "tile [%d, %d) x [%d, %d): %zu bytes of text, "
+                    "%zu bytes of matrix, %d pairs, %.3f ms\n", r0, r1, c0, c1,
+                    text_bytes, (size_t)(r1 - r0) * (c1 - c0) * sizeof(uint16_t),
+                    n_pairs, (now_seconds() - start) * 1e3);
+        }
+    }
+}
+
+/*
+ * Fill the n_elems x n_elems overlap matrix m, of row length stride,
+ * one tile at a time. A tile pairs two blocks of fragments whose text,
+ * and whose block of the matrix, fit in TILE_CACHE_BYTES, so each
+ * fragment of a tile is read from memory once rather than once per pair. Report every tile's memory
+ * and time on stderr.
+ */
+void fill_tiled(char *a[], int len[], const packed_frags *pk, uint16_t m[],
+                int stride, int n_elems)
+{
+    int r0, tile;
+
+    tile = tile_size(len, n_elems);
+    for (r0 = 0; r0 < n_elems; r0 += tile) {
+        fill_tile_row(a, len, pk, m, stride, n_elems, r0, tile, stderr);
+    }
+}
+
+/*
+ * Return 1 if entry col of the row beats the row's best so far, in the
+ * order of beats: the longest overlap, then the first column.
+ */
+int entry_beats(uint16_t entry, int col, int best, int best_col)
+{
+    int n_overlap = entry & ~OVERLAP_CONTAINED;
+
+    return n_overlap > best || (n_overlap == best && col < best_col);
+}
+
+/* Find the best entry of row i of the matrix */
+void scan_row(const uint16_t m[], int stride, int n_elems, int i,
+              int best[], int best_col[])
+{
+    int j;
+
+    best[i] = -1;
+    best_col[i] = n_elems;
+    for (j = 0; j < n_elems; j++) {
+        if (j != i && entry_beats(m[i * stride + j], j, best[i], best_col[i])) {
+            best[i] = m[i * stride + j] & ~OVERLAP_CONTAINED;
+            best_col[i] = j;
+        }
+    }
+}
+
+/* Recompute row i and column i of the matrix after a[i] has changed */
+void update_cross(char *a[], int len[], const packed_frags *pk, uint16_t m[],
+                  int stride, int n_elems, int i)
+{
+    int k;
+
+    for (k = 0; k < n_elems; k++) {
+        if (k != i) {
+            m[i * stride + k] = pair_overlap(a, len, pk, i, k);
+            m[k * stride + i] = pair_overlap(a, len, pk, k, i);
+        }
+    }
+}
+
+/*
+ * Reassemble as reassemble does, with the same result, from a matrix of
+ * all the pairwise overlaps computed up front by fill_tiled.
+ * Each pass then finds the best pair from the rows' best entries, and
+ * only the row and column of the merged fragment are recomputed.
+ * Entries are 16 bits: once a merged fragment is longer than
+ * MAX_TILED_LEN, the rest of the reassembly is left to reassemble.
+ * The matrix is saved with the checkpoints of ctl, and taken from the
+ * checkpoint resumed, if any, rather than computed.
+ * Return the number of fragments left, more than 1 if ctl said to stop.
+ */
+int reassemble_tiled(char *a[], int n_frags, run_ctl *ctl)
+{
+    uint16_t *m;
+    int *len, *best, *best_col;
+    int i, j, r, last, kept, n_overlap, stride = n_frags;
+    int contained, stopped = 0;
+    packed_frags pk;
+
+    m = malloc((size_t)n_frags * n_frags * sizeof(uint16_t));
+    len = malloc(n_frags * sizeof(int));
+    best = malloc(n_frags * sizeof(int));
+    best_col = malloc(n_frags * sizeof(int));
+    if (m == NULL || len == NULL || best == NULL || best_col == NULL) {
+        perror("malloc");
+        exit(1);
+    }
+    for (i = 0; i < n_frags; i++) {
+        len[i] = strlen(a[i]);
+    }
+    packed_init(&pk, a, len, n_frags);
+    if (ctl != NULL && ctl->resume_matrix != NULL) {
+        memcpy(m, ctl->resume_matrix,
+               (size_t)n_frags * n_frags * sizeof(uint16_t));
+    }
+    else {
+        fill_tiled(a, len, &pk, m, stride, n_frags);
+    }
+    for (i = 0; i < n_frags; i++) {
+        scan_row(m, stride, n_frags, i, best, best_col);
+    }
+
+    while (n_frags > 1) {
+        if (ctl_stop(ctl, a, n_frags, m, stride)) {
+            stopped = 1;
+            break;
+        }
+        // The best pair: the longest overlap, then the first (i, j)
+        i = 0;
+        for (r = 1; r < n_frags; r++) {
+            if (best[r] > best[i]) {
+                i = r;
+            }
+        }
+        j = best_col[i];
+        n_overlap = best[i];
+        contained = (m[i * stride + j] & OVERLAP_CONTAINED) != 0;
+        if (!contained && len[i] + len[j] - n_overlap > MAX_TILED_LEN) {
+            break; // too long for the matrix, a[i] and a[j] are untouched
+        }
+
+        // Apply the pass exactly as reassemble_pass does
+        if (!contained) {
+            merge(a, i, j, n_overlap, n_frags);
+            len[i] += len[j] - n_overlap;
+            packed_set(&pk, i, a[i], len[i]);
+        }
+        last = n_frags - 1;
+        free(a[j]);
+        a[j] = a[last];
+        len[j] = len[last];
+        a[last] = NULL;
+        packed_drop(&pk, j);
+        packed_move(&pk, j, last);
+        kept = i == last ? j : i;
+        if (j != last) {
+            // Fragment last moves to position j, with its row and column
+            memcpy(&m[j * stride], &m[last * stride], last * sizeof(uint16_t));
+            for (r = 0; r < last; r++) {
+                m[r * stride + j] = m[r * stride + last];
+            }
+            best[j] = best[last];
+            best_col[j] = best_col[last];
+        }
+        n_frags--;
+        if (!contained) {
+            update_cross(a, len, &pk, m, stride, n_frags, kept);
+        }
+
+        // Only columns j and kept changed, and column last moved to j
+        for (r = 0; r < n_frags; r++) {
+            if (r == j || r == kept) {
+                scan_row(m, stride, n_frags, r, best, best_col);
+                continue;
+            }
+            if (best_col[r] == last && j != last) {
+                best_col[r] = j; // same entry, moved to an earlier column
+            }
+            else
+            if (best_col[r] == j || best_col[r] == kept || best_col[r] == last) {
+                // The best entry changed: a rescan is needed if it dropped
+                if (best_col[r] == last ||
+                    (m[r * stride + best_col[r]] & ~OVERLAP_CONTAINED) <
+                    best[r]) {
+                    scan_row(m, stride, n_frags, r, best, best_col);
+                    continue;
+                }
+                best[r] = m[r * stride + best_col[r]] & ~OVERLAP_CONTAINED;
+            }
+            if (entry_beats(m[r * stride + j], j, best[r], best_col[r])) {
+                best[r] = m[r * stride + j] & ~OVERLAP_CONTAINED;
+                best_col[r] = j;
+            }
+            if (entry_beats(m[r * stride + kept], kept, best[r], best_col[r])) {
+                best[r] = m[r * stride + kept] & ~OVERLAP_CONTAINED;
+                best_col[r] = kept;
+            }
+        }
+    }
+    packed_free(&pk, stride);
+    free(best_col);
+    free(best);
+    free(len);
+    free(m);
+    return stopped ? n_frags : reassemble_until(a, n_frags, ctl);
+}
+
+/* The phases of a round, each run on all the threads */
+enum {
+    PHASE_FILL,
+    PHASE_ROW_BEST,
+    PHASE_COL_BEST,
+    PHASE_MERGE,
+    PHASE_UPDATE,
+};
+
+/*
+ * The state of a round-based reassembly. Fragments keep their index
+ * for the whole reassembly, and are marked dead once merged away.
+ */
+typedef struct {
+    char **a;
+    int *len;
+    packed_frags pk;
+    uint16_t *m; // n x n overlap matrix, as in tiled mode
+    int n; // the number of fragments at the start
+    int tile;
+    char *alive;
+    char *changed; // the fragment was merged this round
+    uint64_t *row_key; // best edge out of each fragment
+    int *row_arg;
+    uint64_t *col_key; // best edge into each fragment
+    int *col_arg;
+    int *pairs; // the pairs (i, j) merged this round
+    int n_pairs;
+    int phase;
+    int n_threads;
+} round_state;
+
+/* The argument of a thread of a round */
+typedef struct {
+    round_state *st;
+    int thread;
+} round_thread;
+
+/*
+ * Rank the edge (i, j) of matrix entry e: by overlap, then by a hash
+ * of (i, j) that breaks ties. Breaking ties by position would leave one
+ * dominant edge per round among fragments that all overlap alike.
+ */
+uint64_t edge_key(uint16_t e, int i, int j)
+{
+    return (uint64_t)(e & ~OVERLAP_CONTAINED) << 32 |
+           mix64((uint64_t)i << 32 | (uint32_t)j) >> 32;
+}
+
+/* Find the best edge of row r, out of fragment r */
+void round_row_best(round_state *st, int r)
+{
+    uint64_t key;
+    int c;
+
+    st->row_arg[r] = -1;
+    for (c = 0; c < st->n; c++) {
+        if (c == r || !st->alive[c]) {
+            continue;
+        }
+        key = edge_key(st->m[(size_t)r * st->n + c], r, c);
+        if (st->row_arg[r] < 0 || key > st->row_key[r]) {
+            st->row_key[r] = key;
+            st->row_arg[r] = c;
+        }
+    }
+}
+
+/* Find the best edges into the columns [c0, c1), scanning row by row */
+void round_col_best(round_state *st, int c0, int c1)
+{
+    uint64_t key;
+    int r, c;
+
+    for (c = c0; c < c1; c++) {
+        st->col_arg[c] = -1;
+    }
+    for (r = 0; r < st->n; r++) {
+        if (!st->alive[r]) {
+            continue;
+        }
+        for (c = c0; c < c1; c++) {
+            if (c == r || !st->alive[c]) {
+                continue;
+            }
+            key = edge_key(st->m[(size_t)r * st->n + c], r, c);
+            if (st->col_arg[c] < 0 || key > st->col_key[c]) {
+                st->col_key[c] = key;
+                st->col_arg[c] = r;
+            }
+        }
+    }
+}
+
+/* Recompute the entries of row r that involve a changed fragment */
+void round_update_row(round_state *st, int r)
+{
+    int c;
+
+    for (c = 0; c < st->n; c++) {
+        if (c != r && st->alive[c] && (st->changed[r] || st->changed[c])) {
+            st->m[(size_t)r * st->n + c] = pair_overlap(st->a, st->len, &st->pk,
+                                                        r, c);
+        }
+    }
+}
+
+/*
+ * Run this thread's share of the current phase. Rows, blocks of
+ * columns and pairs are dealt out round robin, and every matrix entry
+ * is written only by the thread that owns its row.
+ */
+void *round_worker(void *arg)
+{
+    round_thread *rt = arg;
+    round_state *st = rt->st;
+    int k, i, j, c1, n_overlap;
+
+    switch (st->phase) {
+    case PHASE_FILL:
+        for (k = rt->thread * st->tile; k < st->n;
+             k += st->n_threads * st->tile) {
+            fill_tile_row(st->a, st->len, &st->pk, st->m, st->n, st->n, k,
+                          st->tile, NULL);
+        }
+        break;
+    case PHASE_ROW_BEST:
+        for (k = rt->thread; k < st->n; k += st->n_threads) {
+            if (st->alive[k]) {
+                round_row_best(st, k);
+            }
+        }
+        break;
+    case PHASE_COL_BEST:
+        for (k = rt->thread * st->tile; k < st->n;
+             k += st->n_threads * st->tile) {
+            c1 = k + st->tile < st->n ? k + st->tile : st->n;
+            round_col_best(st, k, c1);
+        }
+        break;
+    case PHASE_MERGE:
+        for (k = rt->thread; k < st->n_pairs; k += st->n_threads) {
+            i = st->pairs[2 * k];
+            j = st->pairs[2 * k + 1];
+            n_overlap = st->m[(size_t)i * st->n + j] & ~OVERLAP_CONTAINED;
+            if (!(st->m[(size_t)i * st->n + j] & OVERLAP_CONTAINED)) {
+                merge(st->a, i, j, n_overlap, st->n);
+                st->len[i] += st->len[j] - n_overlap;
+                packed_set(&st->pk, i, st->a[i], st->len[i]);
+                st->changed[i] = 1;
+            }
+            free(st->a[j]);
+            st->a[j] = NULL;
+            packed_drop(&st->pk, j);
+        }
+        break;
+    case PHASE_UPDATE:
+        for (k = rt->thread; k < st->n; k += st->n_threads) {
+            if (st->alive[k]) {
+                round_update_row(st, k);
+            }
+        }
+        break;
+    }
+    return NULL;
+}
+
+/* Run the phase on all the threads, the calling thread included */
+void run_phase(round_state *st, int phase)
+{
+    pthread_t threads[MAX_BATCH_THREADS];
+    round_thread args[MAX_BATCH_THREADS];
+    int t;
+
+    st->phase = phase;
+    for (t = 0; t < st->n_threads; t++) {
+        args[t].st = st;
+        args[t].thread = t;
+    }
+    for (t = 1; t < st->n_threads; t++) {
+        if (pthread_create(&threads[t], NULL, round_worker, &args[t]) != 0) {
+            fprintf(stderr, "Cannot create thread %d\n", t);
+            exit(1);
+        }
+    }
+    round_worker(&args[0]);
+    for (t = 1; t < st->n_threads; t++) {
+        pthread_join(threads[t], NULL);
+    }
+}
+
+/*
+ * Pick the pairs to merge this round: each edge (i, j) that beats every
+ * other edge out of or into i or j. Greedy would merge such a pair
+ * whatever order the others were merged in, and no two of them share a
+ * fragment. Pairs whose merge would not fit the matrix are left out.
+ */
+void round_select(round_state *st)
+{
+    int i, j;
+    uint64_t key;
+    uint16_t e;
+
+    st->n_pairs = 0;
+    for (i = 0; i < st->n; i++) {
+        if (!st->alive[i] || st->row_arg[i] < 0) {
+            continue;
+        }
+        j = st->row_arg[i];
+        key = st->row_key[i];
+        if (st->col_arg[j] != i ||
+            (st->row_arg[j] >= 0 && st->row_key[j] >= key) ||
+            (st->col_arg[i] >= 0 && st->col_key[i] >= key)) {
+            continue;
+        }
+        e = st->m[(size_t)i * st->n + j];
+        if (!(e & OVERLAP_CONTAINED) &&
+            st->len[i] + st->len[j] - (e & ~OVERLAP_CONTAINED) > MAX_TILED_LEN) {
+            continue;
+        }
+        st->pairs[2 * st->n_pairs] = i;
+        st->pairs[2 * st->n_pairs + 1] = j;
+        st->n_pairs++;
+    }
+}
+
+/*
+ * Reassemble in rounds on n_threads threads. Each round merges, at
+ * once, every pair that greedy would merge regardless of the order of
+ * the others, then recomputes the overlaps of the merged fragments.
+ * Typical inputs need about log n rounds rather than n passes. Ties are
+ * broken differently from reassemble, so the result can differ from it.
+ * Once no pair is left whose merge fits the 16-bit matrix, the rest of
+ * the reassembly is left to reassemble. Each round is reported on stderr.
+ * Checkpoints hold the fragments only: the matrix is computed again on
+ * resuming.
+ * Return the number of fragments left, more than 1 if ctl said to stop.
+ */
+int reassemble_rounds(char *a[], int n_frags, int n_threads, run_ctl *ctl)
+{
+    round_state st;
+    char **live;
+    int i, n_alive, round = 0, stopped = 0;
+    double start;
+
+    assert(n_frags > 0);
+    memset(&st, 0, sizeof(st));
+    st.a = a;
+    st.n = n_frags;
+    st.n_threads = n_threads;
+    st.m = malloc((size_t)n_frags * n_frags * sizeof(uint16_t));
+    st.len = malloc(n_frags * sizeof(int));
+    st.alive = malloc(n_frags);
+    st.changed = malloc(n_frags);
+    st.row_key = malloc(n_frags * sizeof(uint64_t));
+    st.row_arg = malloc(n_frags * sizeof(int));
+    st.col_key = malloc(n_frags * sizeof(uint64_t));
+    st.col_arg = malloc(n_frags * sizeof(int));
+    st.pairs = malloc(n_frags * sizeof(int));
+    live = malloc(n_frags * sizeof(char *));
+    if (live == NULL || st.m == NULL || st.len == NULL || st.alive == NULL ||
+        st.changed == NULL || st.row_key == NULL || st.row_arg == NULL ||
+        st.col_key == NULL || st.col_arg == NULL || st.pairs == NULL) {
+        perror("malloc");
+        exit(1);
+    }
+    for (i = 0; i < n_frags; i++) {
+        st.len[i] = strlen(a[i]);
+    }
+    memset(st.alive, 1, n_frags);
+    packed_init(&st.pk, a, st.len, n_frags);
+    st.tile = tile_size(st.len, n_frags);
+    run_phase(&st, PHASE_FILL);
+
+    n_alive = n_frags;
+    while (n_alive > 1) {
+        if (ctl != NULL) {
+            for (i = 0, n_alive = 0; i < n_frags; i++) {
+                if (st.alive[i]) {
+                    live[n_alive++] = a[i];
+                }
+            }
+            if (ctl_stop(ctl, live, n_alive, NULL, 0)) {
+                stopped = 1;
+                break;
+            }
+        }
+        start = now_seconds();
+        run_phase(&st, PHASE_ROW_BEST);
+        run_phase(&st, PHASE_COL_BEST);
+        round_select(&st);
+        if (st.n_pairs == 0) {
+            break;
+        }
+        memset(st.changed, 0, n_frags);
+        run_phase(&st, PHASE_MERGE);
+        for (i = 0; i < st.n_pairs; i++) {
+            st.alive[st.pairs[2 * i + 1]] = 0;
+        }
+        n_alive -= st.n_pairs;
+        run_phase(&st, PHASE_UPDATE);
+        fprintf(stderr, "round %d: %d pairs merged, %d fragments left, "
+                "%.3f ms\n", ++round, st.n_pairs, n_alive,
+                (now_seconds() - start) * 1e3);
+    }
+
+    n_alive = 0;
+    for (i = 0; i < n_frags; i++) {
+        if (st.alive[i]) {
+            a[n_alive++] = a[i];
+        }
+    }
+    packed_free(&st.pk, st.n);
+    free(st.pairs);
+    free(st.col_arg);
+    free(st.col_key);
+    free(st.row_arg);
+    free(st.row_key);
+    free(st.changed);
+    free(st.alive);
+    free(st.len);
+    free(st.m);
+    free(live);
+    return stopped ? n_alive : reassemble_until(a, n_alive, ctl);
+}
+
+/*
+ * Open and read all fragments from the file at filename into frags,
+ * which must have room for MAX_FRAG_COUNT fragments, and reassemble them.
+ * Return the assembled string, or NULL after printing an error.
+ */
+char *reassemble_file(const char *filename, char *frags[],
+                      const reassemble_opts *opts, int *n_fragsp)
+{
+    FILE *fp;
+    int n_frags, n_left;
+    run_ctl ctl;
+
+    memset(&ctl, 0, sizeof(ctl));
+    if (opts->time_budget > 0) {
+        ctl.deadline = now_seconds() + opts->time_budget;
+    }
+    ctl.checkpoint = opts->checkpoint;
+    ctl.next_checkpoint = now_seconds() + CHECKPOINT_INTERVAL;
+
+    fp = open_input(filename);
+    if (fp == NULL) {
+        return NULL;
+    }
+    n_frags = read_all_frags(fp, frags);
+    fclose(fp);
+    *n_fragsp = n_frags > 0 ? n_frags : 0;
+    if (n_frags < 0) {
+        return NULL;
+    }
+    else
+    if (n_frags == 0) {
+        fprintf(stderr, "File must contain at least 1 fragment.\n");
+        return NULL;
+    }
+    if (ctl.checkpoint != NULL) {
+        ctl.input_hash = hash_frags(frags, n_frags);
+        if (access(ctl.checkpoint, F_OK) == 0) {
+            n_frags = load_checkpoint(&ctl, frags, n_frags);
+            if (n_frags < 0) {
+                free_all_memory(frags, *n_fragsp);
+                return NULL;
+            }
+        }
+    }
+    if (opts->max_mismatches > 0) {
+        reassemble_approx(frags, n_frags, opts->max_mismatches);
+        n_left = 1;
+    }
+    else
+    if (opts->rounds) {
+        n_left = reassemble_rounds(frags, n_frags, opts->n_threads, &ctl);
+    }
+    else
+    if (opts->tiled) {
+        n_left = reassemble_tiled(frags, n_frags, &ctl);
+    }
+    else {
+        n_left = reassemble_until(frags, n_frags, &ctl);
+    }
+    free(ctl.resume_matrix);
+    if (n_left > 1) {
+        fprintf(stderr, "Time budget spent with %d contigs left%s%s\n",
+                n_left, ctl.checkpoint != NULL ? ", checkpoint in " : "",
+                ctl.checkpoint != NULL ? ctl.checkpoint : "");
+        concat_contigs(frags, n_left);
+    }
+    else
+    if (ctl.checkpoint != NULL) {
+        remove(ctl.checkpoint); // done, nothing left to resume
+    }
+    return frags[0];
+}
+
+/* A fragment of the out-of-core store, and its place in a chain */
+typedef struct {
+    uint64_t offset; // of its text in the store
+    int len;
+    int prev; // fragment before it in its chain, or -1
+    int next; // fragment after it in its chain, or -1
+    int n_overlap; // characters shared with prev, not written again
+    int chain; // union-find parent, a fragment of the same chain
+    int last_x; // last fragment found overlapping it, while scanning
+    int contained; // 1 if another fragment contains it
+} stored_frag;
+
+/* The fingerprint of the SEED_LEN characters of a fragment at pos */
+typedef struct {
+    uint64_t hash;
+    int id;
+    int pos;
+} frag_print;
+
+/* The state of an out-of-core reassembly */
+typedef struct {
+    const char *text; // the store, mapped
+    size_t size;
+    stored_frag *frags;
+    int n_frags, frags_cap;
+    frag_print *prints; // of fragments of at least SEED_LEN characters
+    int n_prints;
+    overlap_edge *edges; // y starts offset characters into x
+    int n_edges, edges_cap;
+    int short_lens; // bit L set if a fragment is L < SEED_LEN long
+} store_state;
+
+/* Polynomial hash of the n characters at s, as find_minimizers seeds */
+uint64_t text_hash(const char *s, int n)
+{
+    uint64_t h = 0;
+    int i;
+
+    for (i = 0; i < n; i++) {
+        h = h * 131 + (unsigned char)s[i];
+    }
+    return h;
+}
+
+/* Return 131 to the power SEED_LEN, to roll text_hash along a string */
+uint64_t seed_top(void)
+{
+    uint64_t top = 1;
+    int i;
+
+    for (i = 0; i < SEED_LEN; i++) {
+        top *= 131;
+    }
+    return top;
+}
+
+const char *stored_text(const store_state *st, int id)
+{
+    return st->text + st->frags[id].offset;
+}
+
+/* Add a fragment of len characters at the end of the store */
+void store_add(store_state *st, int len)
+{
+    stored_frag *f;
+
+    reserve(&st->frags, &st->frags_cap, st->n_frags + 1, sizeof(stored_frag));
+    f = &st->frags[st->n_frags];
+    memset(f, 0, sizeof(*f));
+    f->offset = st->size;
+    f->len = len;
+    f->prev = f->next = f->last_x = -1;
+    f->chain = st->n_frags++;
+    st->size += len;
+}
+
+/*
+ * Append each fragment read from fp to the store file, keeping only its
+ * position in st. Return the number of fragments, or -1 on error.
+ */
+int store_fill(FILE *fp, FILE *store, store_state *st)
+{
+    char *frag;
+    int r, len;
+
+    while ((r = read_frag(fp, &frag)) == 0 && frag != NULL) {
+        len = strlen(frag);
+        if (fwrite(frag, 1, len, store) != (size_t)len) {
+            perror("fwrite");
+            free(frag);
+            return -1;
+        }
+        store_add(st, len);
+        free(frag);
+    }
+    return r < 0 ? -1 : st->n_frags;
+}
+
+/* Order fingerprints by hash, then by fragment, then by position */
+int cmp_frag_print(const void *p1, const void *p2)
+{
+    const frag_print *f1 = p1;
+    const frag_print *f2 = p2;
+
+    if (f1->hash != f2->hash) {
+        return f1->hash < f2->hash ? -1 : 1;
+    }
+    if (f1->id != f2->id) {
+        return f1->id - f2->id;
+    }
+    return f1->pos - f2->pos;
+}
+
+/* Return the first of n fingerprints with a hash of at least hash */
+int lower_print(const frag_print prints[], int n, uint64_t hash)
+{
+    int lo = 0, hi = n, mid;
+
+    while (lo < hi) {
+        mid = lo + (hi - lo) / 2;
+        if (prints[mid].hash < hash) {
+            lo = mid + 1;
+        }
+        else {
+            hi = mid;
+        }
+    }
+    return lo;
+}
+
+/*
+ * The first SEED_LEN characters of fragment y occur in fragment x at p.
+ * Mark y contained if x contains it there, or else record the overlap
+ * of the suffix of x from p with a prefix of y, if they match. Only the
+ * first match of a pair, at the smallest p, is kept.
+ */
+void store_check(store_state *st, int x, int p, int y)
+{
+    const char *s = stored_text(st, x);
+    stored_frag *fy = &st->frags[y];
+    overlap_edge e;
+    int n_x = st->frags[x].len;
+
+    if (y == x || fy->last_x == x) {
+        return; // a longer overlap was found at a smaller p
+    }
+    if (p + fy->len <= n_x) {
+        if (memcmp(s + p, stored_text(st, y), fy->len) == 0) {
+            // Of two equal fragments, the first is kept
+            if (fy->len < n_x || x < y) {
+                fy->contained = 1;
+            }
+            fy->last_x = x;
+        }
+        return;
+    }
+    if (p > 0 && memcmp(s + p, stored_text(st, y), n_x - p) == 0) {
+        e.score = n_x - p;
+        e.x = x;
+        e.y = y;
+        e.offset = p;
+        e.contained = 0;
+        reserve(&st->edges, &st->edges_cap, st->n_edges + 1,
+                sizeof(overlap_edge));
+        st->edges[st->n_edges++] = e;
+        fy->last_x = x;
+    }
+}
+
+/*
+ * Find every fragment y whose first SEED_LEN characters occur in
+ * fragment x, and check each occurrence with store_check.
+ */
+void store_scan(store_state *st, int x)
+{
+    const char *s = stored_text(st, x);
+    uint64_t h, top = seed_top();
+    int k, p, n_x = st->frags[x].len;
+
+    h = text_hash(s, SEED_LEN);
+    for (p = 0; p + SEED_LEN <= n_x; p++) {
+        if (p > 0) {
+            h = h * 131 + (unsigned char)s[p + SEED_LEN - 1] -
+                top * (unsigned char)s[p - 1];
+        }
+        k = lower_print(st->prints, st->n_prints, h);
+        for (; k < st->n_prints && st->prints[k].hash == h; k++) {
+            store_check(st, x, p, st->prints[k].id);
+        }
+    }
+}
+
+/*
+ * Mark the fragments shorter than SEED_LEN that another fragment
+ * contains, looking every substring that short up in a hash table.
+ * Nothing is done unless a fragment from first on is that short.
+ */
+void store_scan_short(store_state *st, int first)
+{
+    const char *s;
+    int *table;
+    int i, n_table = 16, slot, x, p, n, y, n_new = 0;
+    uint64_t h;
+
+    for (i = 0; i < st->n_frags; i++) {
+        if (st->frags[i].len < SEED_LEN) {
+            st->short_lens |= 1 << st->frags[i].len;
+            n_table++;
+            n_new += i >= first;
+        }
+    }
+    if (n_new == 0) {
+        return;
+    }
+    while (n_table & (n_table - 1)) {
+        n_table &= n_table - 1;
+    }
+    n_table *= 4; // a power of two, at most half full
+    table = malloc(n_table * sizeof(int));
+    if (table == NULL) {
+        perror("malloc");
+        exit(1);
+    }
+    memset(table, -1, n_table * sizeof(int));
+    for (i = 0; i < st->n_frags; i++) {
+        n = st->frags[i].len;
+        if (n >= SEED_LEN) {
+            continue;
+        }
+        s = stored_text(st, i);
+        slot = mix64(text_hash(s, n) + n) & (n_table - 1);
+        for (; table[slot] >= 0; slot = (slot + 1) & (n_table - 1)) {
+            y = table[slot];
+            if (st->frags[y].len == n && memcmp(stored_text(st, y), s, n) == 0) {
+                st->frags[i].contained = 1; // a copy of an earlier one
+                break;
+            }
+        }
+        if (table[slot] < 0) {
+            table[slot] = i;
+        }
+    }
+
+    for (x = 0; x < st->n_frags; x++) {
+        s = stored_text(st, x);
+        for (p = 0; p < st->frags[x].len; p++) {
+            h = 0;
+            for (n = 1; n < SEED_LEN && p + n <= st->frags[x].len; n++) {
+                h = h * 131 + (unsigned char)s[p + n - 1];
+                if (n == st->frags[x].len || !(st->short_lens & (1 << n))) {
+                    continue;
+                }
+                slot = mix64(h + n) & (n_table - 1);
+                for (; (y = table[slot]) >= 0; slot = (slot + 1) & (n_table - 1)) {
+                    if (st->frags[y].len == n &&
+                        memcmp(stored_text(st, y), s + p, n) == 0) {
+                        st->frags[y].contained = 1;
+                        break;
+                    }
+                }
+            }
+        }
+    }
+    free(table);
+}
+
+/* Fingerprint the first SEED_LEN characters of every fragment */
+void store_prints(store_state *st)
+{
+    int i;
+
+    st->prints = malloc(st->n_frags * sizeof(frag_print));
+    if (st->prints == NULL) {
+        perror("malloc");
+        exit(1);
+    }
+    for (i = 0; i < st->n_frags; i++) {
+        if (st->frags[i].len >= SEED_LEN) {
+            st->prints[st->n_prints].hash = text_hash(stored_text(st, i),
+                                                      SEED_LEN);
+            st->prints[st->n_prints].pos = 0;
+            st->prints[st->n_prints++].id = i;
+        }
+    }
+    if (st->n_prints > 1) {
+        qsort(st->prints, st->n_prints, sizeof(frag_print), cmp_frag_print);
+    }
+}
+
+/* Return a fragment standing for the whole chain of fragment id */
+int chain_find(store_state *st, int id)
+{
+    while (st->frags[id].chain != id) {
+        st->frags[id].chain = st->frags[st->frags[id].chain].chain;
+        id = st->frags[id].chain;
+    }
+    return id;
+}
+
+/* Chain y after x, sharing n_overlap characters */
+void store_link(store_state *st, int x, int y, int n_overlap)
+{
+    st->frags[x].next = y;
+    st->frags[y].prev = x;
+    st->frags[y].n_overlap = n_overlap;
+    st->frags[chain_find(st, y)].chain = chain_find(st, x);
+}
+
+/*
+ * Order overlaps longest first, ties as reassemble_pass breaks them:
+ * by the fragment whose prefix overlaps, then by the other.
+ */
+int cmp_store_edge(const void *p1, const void *p2)
+{
+    const overlap_edge *e1 = p1;
+    const overlap_edge *e2 = p2;
+
+    if (e1->score != e2->score) {
+        return e2->score - e1->score;
+    }
+    if (e1->y != e2->y) {
+        return e1->y - e2->y;
+    }
+    return e1->x - e2->x;
+}
+
+/* Link fragments along the overlaps found, longest first */
+void store_link_edges(store_state *st)
+{
+    overlap_edge *e;
+    int i;
+
+    if (st->n_edges > 1) {
+        qsort(st->edges, st->n_edges, sizeof(overlap_edge), cmp_store_edge);
+    }
+    for (i = 0; i < st->n_edges; i++) {
+        e = &st->edges[i];
+        if (st->frags[e->x].contained || st->frags[e->y].contained ||
+            st->frags[e->x].next >= 0 || st->frags[e->y].prev >= 0 ||
+            chain_find(st, e->x) == chain_find(st, e->y)) {
+            continue;
+        }
+        store_link(st, e->x, e->y, e->score);
+    }
+}
+
+/*
+ * Link chains that overlap by fewer than SEED_LEN characters, which the
+ * fingerprints cannot find, longest first. Only the last fragment of a
+ * chain and the first of another are compared.
+ */
+void store_link_ends(store_state *st)
+{
+    frag_print *tails;
+    stored_frag *f;
+    uint64_t h;
+    int n, i, k, t, n_tails;
+
+    tails = malloc(st->n_frags * sizeof(frag_print));
+    if (tails == NULL) {
+        perror("malloc");
         exit(1);
     }
-    if (argc > 2) {
-       fprintf(stderr, "Ignoring excess arguments...\n");
+    for (n = SEED_LEN - 1; n > 0; n--) {
+        n_tails = 0;
+        for (i = 0; i < st->n_frags; i++) {
+            f = &st->frags[i];
+            if (!f->contained && f->next < 0 && f->len > n) {
+                tails[n_tails].hash = text_hash(stored_text(st, i) + f->len - n, n);
+                tails[n_tails].pos = f->len - n;
+                tails[n_tails++].id = i;
+            }
+        }
+        if (n_tails > 1) {
+            qsort(tails, n_tails, sizeof(frag_print), cmp_frag_print);
+        }
+        for (i = 0; i < st->n_frags; i++) {
+            f = &st->frags[i];
+            if (f->contained || f->prev >= 0 || f->len <= n) {
+                continue;
+            }
+            h = text_hash(stored_text(st, i), n);
+            k = lower_print(tails, n_tails, h);
+            for (; k < n_tails && tails[k].hash == h; k++) {
+                t = tails[k].id;
+                if (st->frags[t].next < 0 && chain_find(st, t) != chain_find(st, i) &&
+                    memcmp(stored_text(st, t) + st->frags[t].len - n,
+                           stored_text(st, i), n) == 0) {
+                    store_link(st, t, i, n);
+                    break;
+                }
+            }
+        }
+    }
+    free(tails);
+}
+
+/*
+ * Write the chains to out one after the other, first fragments in input
+ * order, each fragment without the characters it shares with the one
+ * before it. Return -1 if writing failed.
+ */
+int store_write(const store_state *st, FILE *out)
+{
+    const stored_frag *f;
+    int i, id;
+
+    for (i = 0; i < st->n_frags; i++) {
+        if (st->frags[i].contained || st->frags[i].prev >= 0) {
+            continue;
+        }
+        for (id = i; id >= 0; id = f->next) {
+            f = &st->frags[id];
+            fwrite(stored_text(st, id) + f->n_overlap, 1,
+                   f->len - f->n_overlap, out);
+        }
+    }
+    fputc('\n', out);
+    if (fflush(out) != 0 || ferror(out)) {
+        perror("fwrite");
+        return -1;
     }
-    filename = argv[1]; // always take the first argument
-    fp = fopen(filename, "r");
+    return 0;
+}
+
+/*
+ * Reassemble the file at filename out of core, keeping the fragment text
+ * in a store file at store_path, and print the result.
+ * Return 0, or -1 after printing an error.
+ */
+int reassemble_external(const char *filename, const char *store_path)
+{
+    store_state st;
+    FILE *fp, *store;
+    void *text;
+    int i, n_frags;
+
+    memset(&st, 0, sizeof(st));
+    fp = open_input(filename);
     if (fp == NULL) {
-        fprintf(stderr, "Cannot open file \"%s\"\n", filename);
+        return -1;
+    }
+    store = fopen(store_path, "w+");
+    if (store == NULL) {
+        perror(store_path);
+        fclose(fp);
+        return -1;
+    }
+    n_frags = store_fill(fp, store, &st);
+    fclose(fp);
+    if (n_frags == 0) {
+        fprintf(stderr, "File must contain at least 1 fragment.\n");
+    }
+    text = MAP_FAILED;
+    if (n_frags > 0 && fflush(store) == 0) {
+        text = mmap(NULL, st.size, PROT_READ, MAP_PRIVATE, fileno(store), 0);
+        if (text == MAP_FAILED) {
+            perror("mmap");
+        }
+    }
+    fclose(store);
+    remove(store_path); // the mapping keeps it until munmap
+    if (text == MAP_FAILED) {
+        free(st.frags);
+        return -1;
+    }
+    st.text = text;
+
+    store_prints(&st);
+    for (i = 0; i < n_frags; i++) {
+        if (st.frags[i].len >= SEED_LEN) {
+            store_scan(&st, i);
+        }
+    }
+    store_scan_short(&st, 0);
+    store_link_edges(&st);
+    store_link_ends(&st);
+    i = store_write(&st, stdout);
+
+    munmap(text, st.size);
+    free(st.edges);
+    free(st.prints);
+    free(st.frags);
+    return i;
+}
+
+static const char index_magic[8] = "RASMIDX";
+
+/*
+ * The header of an index file. It is followed by the length of each
+ * contig as a uint32_t, then by the contigs without their '\0', then by
+ * n_seeds fingerprints, one for the SEED_LEN characters at every position
+ * of every contig, in the order of cmp_frag_print.
+ */
+typedef struct {
+    char magic[8];
+    uint32_t version;
+    uint32_t n_contigs;
+    uint32_t n_seeds;
+    uint32_t reserved;
+} index_header;
+
+enum {
+    INDEX_VERSION = 1,
+};
+
+/* The seeds of the contigs of an index file */
+typedef struct {
+    frag_print *seeds; // id is the contig
+    int n_seeds;
+} contig_index;
+
+/* Return whether the seed lies wholly in one of the n_contigs of len */
+int valid_seed(const frag_print *seed, const uint32_t *len,
+               uint32_t n_contigs)
+{
+    return seed->id >= 0 && (uint32_t)seed->id < n_contigs &&
+           seed->pos >= 0 &&
+           (uint64_t)seed->pos + SEED_LEN <= len[seed->id];
+}
+
+/*
+ * Add the contigs of the index file at path to the store, writing their
+ * text to text, and load their seeds into ix.
+ * Return the number of contigs, or -1 if the file is not a whole index.
+ */
+int load_index(const char *path, FILE *text, store_state *st, contig_index *ix)
+{
+    index_header header;
+    uint32_t *len;
+    char block[RING_BLOCK_SIZE];
+    uint64_t total = 0;
+    size_t n;
+    FILE *fp;
+    int i, ok;
+
+    fp = fopen(path, "rb");
+    if (fp == NULL) {
+        perror(path);
+        return -1;
+    }
+    ok = fread(&header, sizeof(header), 1, fp) == 1 &&
+         memcmp(header.magic, index_magic, sizeof(header.magic)) == 0 &&
+         header.version == INDEX_VERSION && header.n_contigs >= 1;
+    if (!ok) {
+        fprintf(stderr, "\"%s\" is not an index file.\n", path);
+        fclose(fp);
+        return -1;
+    }
+    len = malloc(header.n_contigs * sizeof(uint32_t));
+    ix->seeds = malloc((header.n_seeds + 1) * sizeof(frag_print));
+    if (len == NULL || ix->seeds == NULL) {
+        perror("malloc");
         exit(1);
     }
-    n_frags = read_all_frags(fp, frags);
+    ok = fread(len, sizeof(uint32_t), header.n_contigs, fp) == header.n_contigs;
+    for (i = 0; i < (int)header.n_contigs && ok; i++) {
+        ok = len[i] > 0;
+        total += len[i];
+    }
+    while (ok && total > 0) {
+        n = total < sizeof(block) ? total : sizeof(block);
+        ok = fread(block, 1, n, fp) == n && fwrite(block, 1, n, text) == n;
+        total -= n;
+    }
+    ok = ok && fread(ix->seeds, sizeof(frag_print), header.n_seeds, fp) ==
+               header.n_seeds;
     fclose(fp);
-    if (n_frags < 0) {
+    if (!ok) {
+        fprintf(stderr, "Index \"%s\" is truncated.\n", path);
+        free(len);
+        return -1;
+    }
+    // index_scan and save_index trust every seed to lie in its contig
+    for (i = 0; i < (int)header.n_seeds && ok; i++) {
+        ok = valid_seed(&ix->seeds[i], len, header.n_contigs);
+    }
+    if (!ok) {
+        fprintf(stderr, "Index \"%s\" has a seed outside the contigs.\n",
+                path);
+        free(len);
+        return -1;
+    }
+    for (i = 0; i < (int)header.n_contigs; i++) {
+        store_add(st, len[i]);
+    }
+    ix->n_seeds = header.n_seeds;
+    free(len);
+    return header.n_contigs;
+}
+
+/*
+ * Look the first SEED_LEN characters of fragment y up in the seeds of
+ * the contigs, and check each occurrence with store_check.
+ */
+void index_scan(store_state *st, const contig_index *ix, int y)
+{
+    uint64_t h = text_hash(stored_text(st, y), SEED_LEN);
+    int k;
+
+    k = lower_print(ix->seeds, ix->n_seeds, h);
+    for (; k < ix->n_seeds && ix->seeds[k].hash == h; k++) {
+        store_check(st, ix->seeds[k].id, ix->seeds[k].pos, y);
+    }
+}
+
+/* Append the seeds of the contig s of n characters, numbered id */
+void add_seeds(contig_index *ix, int *cap, const char *s, int n, int id)
+{
+    uint64_t h, top = seed_top();
+    int p;
+
+    if (n < SEED_LEN) {
+        return;
+    }
+    reserve(&ix->seeds, cap, ix->n_seeds + n - SEED_LEN + 1,
+            sizeof(frag_print));
+    h = text_hash(s, SEED_LEN);
+    for (p = 0; p + SEED_LEN <= n; p++) {
+        if (p > 0) {
+            h = h * 131 + (unsigned char)s[p + SEED_LEN - 1] -
+                top * (unsigned char)s[p - 1];
+        }
+        ix->seeds[ix->n_seeds].hash = h;
+        ix->seeds[ix->n_seeds].id = id;
+        ix->seeds[ix->n_seeds++].pos = p;
+    }
+}
+
+/* Return the length of the chain starting at fragment head */
+int chain_len(const store_state *st, int head)
+{
+    int id, len = 0;
+
+    for (id = head; id >= 0; id = st->frags[id].next) {
+        len += st->frags[id].len - st->frags[id].n_overlap;
+    }
+    return len;
+}
+
+/* Write the text of the chain starting at fragment head to s */
+void chain_text(const store_state *st, int head, char *s)
+{
+    const stored_frag *f;
+    int id;
+
+    for (id = head; id >= 0; id = f->next) {
+        f = &st->frags[id];
+        memcpy(s, stored_text(st, id) + f->n_overlap, f->len - f->n_overlap);
+        s += f->len - f->n_overlap;
+    }
+}
+
+/*
+ * Write the chains of the store, as contigs, with their seeds to the
+ * index file at path. An old contig, one of the first n_old fragments,
+ * that is still a chain of its own keeps its seeds from ix; the seeds
+ * of the other contigs are computed. The file is written under a
+ * temporary name and renamed, as a checkpoint is.
+ * Return -1 on an I/O error.
+ */
+int save_index(const char *path, const store_state *st, contig_index *ix,
+               int n_old)
+{
+    index_header header;
+    char tmp_path[strlen(path) + sizeof(".tmp")];
+    contig_index fresh = {NULL, 0};
+    int *heads, *new_id;
+    uint32_t *len;
+    char *s;
+    int i, k, n_contigs = 0, n_kept = 0, fresh_cap = 0, ok;
+    FILE *fp;
+
+    heads = malloc(st->n_frags * sizeof(int));
+    len = malloc(st->n_frags * sizeof(uint32_t));
+    new_id = malloc((n_old + 1) * sizeof(int));
+    if (heads == NULL || len == NULL || new_id == NULL) {
+        perror("malloc");
         exit(1);
     }
-    else
-    if (n_frags == 0) {
+    for (i = 0; i < n_old; i++) {
+        new_id[i] = -1;
+    }
+    for (i = 0; i < st->n_frags; i++) {
+        if (st->frags[i].contained || st->frags[i].prev >= 0) {
+            continue;
+        }
+        len[n_contigs] = chain_len(st, i);
+        if (i < n_old && st->frags[i].next < 0) {
+            new_id[i] = n_contigs;
+        }
+        else {
+            s = malloc(len[n_contigs]);
+            if (s == NULL) {
+                perror("malloc");
+                exit(1);
+            }
+            chain_text(st, i, s);
+            add_seeds(&fresh, &fresh_cap, s, len[n_contigs], n_contigs);
+            free(s);
+        }
+        heads[n_contigs++] = i;
+    }
+    if (fresh.n_seeds > 1) {
+        qsort(fresh.seeds, fresh.n_seeds, sizeof(frag_print), cmp_frag_print);
+    }
+    // Renumbering keeps the order of the seeds kept
+    for (k = 0; k < ix->n_seeds; k++) {
+        if (new_id[ix->seeds[k].id] >= 0) {
+            ix->seeds[n_kept] = ix->seeds[k];
+            ix->seeds[n_kept++].id = new_id[ix->seeds[k].id];
+        }
+    }
+
+    sprintf(tmp_path, "%s.tmp", path);
+    fp = fopen(tmp_path, "wb");
+    if (fp == NULL) {
+        perror(tmp_path);
+        ok = 0;
+    }
+    else {
+        memset(&header, 0, sizeof(header));
+        memcpy(header.magic, index_magic, sizeof(header.magic));
+        header.version = INDEX_VERSION;
+        header.n_contigs = n_contigs;
+        header.n_seeds = n_kept + fresh.n_seeds;
+        ok = fwrite(&header, sizeof(header), 1, fp) == 1 &&
+             fwrite(len, sizeof(uint32_t), n_contigs, fp) == (size_t)n_contigs;
+        for (i = 0; i < n_contigs && ok; i++) {
+            for (k = heads[i]; k >= 0 && ok; k = st->frags[k].next) {
+                ok = fwrite(stored_text(st, k) + st->frags[k].n_overlap, 1,
+                            st->frags[k].len - st->frags[k].n_overlap, fp) ==
+                     (size_t)(st->frags[k].len - st->frags[k].n_overlap);
+            }
+        }
+        // Merge the seeds kept with the fresh ones
+        for (i = 0, k = 0; (i < n_kept || k < fresh.n_seeds) && ok;) {
+            if (k == fresh.n_seeds ||
+                (i < n_kept && cmp_frag_print(&ix->seeds[i], &fresh.seeds[k]) < 0)) {
+                ok = fwrite(&ix->seeds[i++], sizeof(frag_print), 1, fp) == 1;
+            }
+            else {
+                ok = fwrite(&fresh.seeds[k++], sizeof(frag_print), 1, fp) == 1;
+            }
+        }
+        if (fclose(fp) != 0) {
+            ok = 0;
+        }
+        if (!ok || rename(tmp_path, path) != 0) {
+            perror(path);
+            remove(tmp_path);
+            ok = 0;
+        }
+    }
+    if (ok) {
+        fprintf(stderr, "Index \"%s\": %d contigs, %d seeds kept, %d computed\n",
+                path, n_contigs, n_kept, fresh.n_seeds);
+    }
+    free(fresh.seeds);
+    free(new_id);
+    free(len);
+    free(heads);
+    return ok ? 0 : -1;
+}
+
+/*
+ * Reassemble the fragments of the file at filename together with the
+ * contigs of the index file at index_path, if it exists, as --store
+ * does but in memory, and print the result. The contigs, as linked by
+ * overlaps of at least SEED_LEN characters, are written back to the
+ * index, to be extended by the next run.
+ * Only the new fragments are looked for, in the seeds of the contigs
+ * and in each other, so the contigs are never compared with each other.
+ * Return 0, or -1 after printing an error.
+ */
+int reassemble_incremental(const char *filename, const char *index_path)
+{
+    store_state st;
+    contig_index ix = {NULL, 0};
+    FILE *fp = NULL, *text;
+    char *buf = NULL;
+    size_t size = 0;
+    int i, n_old = 0, n_frags = -1, r = -1;
+
+    memset(&st, 0, sizeof(st));
+    text = open_memstream(&buf, &size);
+    if (text == NULL) {
+        perror("open_memstream");
+        exit(1);
+    }
+    if (access(index_path, F_OK) == 0) {
+        n_old = load_index(index_path, text, &st, &ix);
+    }
+    if (n_old >= 0) {
+        fp = open_input(filename);
+    }
+    if (fp != NULL) {
+        n_frags = store_fill(fp, text, &st);
+        fclose(fp);
+    }
+    if (n_frags >= 0 && n_frags == n_old) {
         fprintf(stderr, "File must contain at least 1 fragment.\n");
+    }
+    if (n_frags > n_old && fflush(text) == 0) {
+        st.text = buf;
+        store_prints(&st);
+        for (i = n_old; i < n_frags; i++) {
+            if (st.frags[i].len >= SEED_LEN) {
+                store_scan(&st, i);
+                index_scan(&st, &ix, i);
+            }
+        }
+        store_scan_short(&st, n_old);
+        store_link_edges(&st);
+        // Short overlaps are too often chance ones to be kept in the index
+        r = save_index(index_path, &st, &ix, n_old);
+        store_link_ends(&st);
+        if (r == 0) {
+            r = store_write(&st, stdout);
+        }
+    }
+    fclose(text);
+    free(buf);
+    free(ix.seeds);
+    free(st.edges);
+    free(st.prints);
+    free(st.frags);
+    return r;
+}
+
+/* A file of a batch, and how its reassembly went */
+typedef struct {
+    char *in_path;
+    char *out_path;
+    int n_frags;
+    int failed;
+    double seconds;
+} batch_job;
+
+/* The files of a batch, claimed one at a time by the workers */
+typedef struct {
+    batch_job *jobs;
+    int n_jobs;
+    int next_job;
+    reassemble_opts opts;
+} batch_state;
+
+/*
+ * Name the output file after the input file, with its extension
+ * replaced by .out: test1.txt gives test1.out.
+ */
+char *batch_out_path(const char *in_path)
+{
+    const char *dot, *slash;
+    char *out_path;
+    int n_base;
+
+    dot = strrchr(in_path, '.');
+    slash = strrchr(in_path, '/');
+    if (dot == NULL || (slash != NULL && dot < slash)) {
+        dot = in_path + strlen(in_path);
+    }
+    n_base = dot - in_path;
+    out_path = malloc(n_base + strlen(".out") + 1);
+    if (out_path == NULL) {
+        perror("malloc");
+        exit(1);
+    }
+    memcpy(out_path, in_path, n_base);
+    strcpy(out_path + n_base, ".out");
+    return out_path;
+}
+
+/* Reassemble one file of the batch and write the result to its out_path */
+void batch_run_job(batch_job *job, char *frags[], const reassemble_opts *opts)
+{
+    double start;
+    char *result;
+    FILE *fp;
+
+    start = now_seconds();
+    result = reassemble_file(job->in_path, frags, opts, &job->n_frags);
+    job->failed = result == NULL;
+    if (result != NULL) {
+        fp = fopen(job->out_path, "w");
+        if (fp == NULL) {
+            fprintf(stderr, "Cannot open file \"%s\"\n", job->out_path);
+            job->failed = 1;
+        }
+        else {
+            fprintf(fp, "%s\n", result);
+            if (fclose(fp) != 0) {
+                perror(job->out_path);
+                job->failed = 1;
+            }
+        }
+        free(result);
+    }
+    job->seconds = now_seconds() - start;
+}
+
+/*
+ * Claim and run jobs until none are left.
+ * The fragment array is the worker's own and is reused from file to file.
+ */
+void *batch_worker(void *arg)
+{
+    batch_state *b = arg;
+    char **frags;
+    int i;
+
+    frags = malloc(MAX_FRAG_COUNT * sizeof(char *));
+    if (frags == NULL) {
+        perror("malloc");
+        exit(1);
+    }
+    while ((i = __atomic_fetch_add(&b->next_job, 1, __ATOMIC_RELAXED)) <
+           b->n_jobs) {
+        batch_run_job(&b->jobs[i], frags, &b->opts);
+    }
+    free(frags);
+    return NULL;
+}
+
+int cmp_path(const void *p1, const void *p2)
+{
+    return strcmp(*(char * const *)p1, *(char * const *)p2);
+}
+
+/*
+ * Check that no two jobs write the same output file and that no job
+ * writes over an input file, which would race with the job reading it.
+ * Return -1 after printing the first clash found.
+ */
+int check_batch_paths(const batch_state *b)
+{
+    char **paths;
+    int i, r = 0;
+
+    paths = malloc(2 * (b->n_jobs + 1) * sizeof(char *));
+    if (paths == NULL) {
+        perror("malloc");
+        exit(1);
+    }
+    for (i = 0; i < b->n_jobs; i++) {
+        paths[2 * i] = b->jobs[i].in_path;
+        paths[2 * i + 1] = b->jobs[i].out_path;
+    }
+    qsort(paths, 2 * b->n_jobs, sizeof(char *), cmp_path);
+    for (i = 1; i < 2 * b->n_jobs; i++) {
+        if (strcmp(paths[i - 1], paths[i]) == 0) {
+            fprintf(stderr, "Manifest uses \"%s\" more than once, as an "
+                            "input or an output.\n", paths[i]);
+            r = -1;
+            break;
+        }
+    }
+    free(paths);
+    return r;
+}
+
+/*
+ * Read the manifest at path, one input file per line, into b->jobs.
+ * Return -1 if the manifest cannot be read, or if two of its files
+ * would share an output file.
+ */
+int read_manifest(const char *path, batch_state *b)
+{
+    FILE *fp;
+    char *line = NULL;
+    size_t line_cap = 0;
+    ssize_t n;
+    int cap = 0;
+
+    fp = fopen(path, "r");
+    if (fp == NULL) {
+        fprintf(stderr, "Cannot open file \"%s\"\n", path);
+        return -1;
+    }
+    while ((n = getline(&line, &line_cap, fp)) != -1) {
+        while (n > 0 && iswspace(line[n - 1])) {
+            line[--n] = '\0';
+        }
+        if (n == 0) {
+            continue; // skip blank lines
+        }
+        reserve(&b->jobs, &cap, b->n_jobs + 1, sizeof(batch_job));
+        memset(&b->jobs[b->n_jobs], 0, sizeof(batch_job));
+        b->jobs[b->n_jobs].in_path = strdup(line);
+        if (b->jobs[b->n_jobs].in_path == NULL) {
+            perror("strdup");
+            exit(1);
+        }
+        b->jobs[b->n_jobs].out_path = batch_out_path(line);
+        b->n_jobs++;
+    }
+    free(line);
+    if (ferror(fp)) {
+        perror(path);
+        fclose(fp);
+        return -1;
+    }
+    fclose(fp);
+    return check_batch_paths(b);
+}
+
+/*
+ * Reassemble every file listed in the manifest on n_threads threads, then
+ * print one summary line per file, in manifest order.
+ * Return the number of files that failed.
+ */
+int reassemble_batch(const char *manifest, int n_threads,
+                     const reassemble_opts *opts)
+{
+    batch_state b;
+    pthread_t threads[MAX_BATCH_THREADS];
+    double start, elapsed;
+    int i, n_failed = 0;
+
+    memset(&b, 0, sizeof(b));
+    b.opts = *opts;
+    if (read_manifest(manifest, &b) < 0) {
+        exit(1);
+    }
+    if (n_threads > b.n_jobs) {
+        n_threads = b.n_jobs > 0 ? b.n_jobs : 1;
+    }
+    start = now_seconds();
+    for (i = 1; i < n_threads; i++) {
+        if (pthread_create(&threads[i], NULL, batch_worker, &b) != 0) {
+            fprintf(stderr, "Cannot create thread %d\n", i);
+            exit(1);
+        }
+    }
+    batch_worker(&b); // the main thread is worker 0
+    for (i = 1; i < n_threads; i++) {
+        pthread_join(threads[i], NULL);
+    }
+    elapsed = now_seconds() - start;
+
+    for (i = 0; i < b.n_jobs; i++) {
+        printf("%s\t%d fragments\t%.3f ms\t%s\n", b.jobs[i].in_path,
+               b.jobs[i].n_frags, b.jobs[i].seconds * 1e3,
+               b.jobs[i].failed ? "failed" : b.jobs[i].out_path);
+        n_failed += b.jobs[i].failed;
+        free(b.jobs[i].in_path);
+        free(b.jobs[i].out_path);
+    }
+    printf("%d files, %d failed, %d threads, %.3f ms\n", b.n_jobs, n_failed,
+           n_threads, elapsed * 1e3);
+    free(b.jobs);
+    return n_failed;
+}
+
+/* Print how to run the program, and exit */
+void usage(const char *prog)
+{
+    fprintf(stderr, "Usage: %s [-k mismatches | -t | -r] [-j threads] "
+                    "[--time-budget seconds] [--checkpoint file] file\n"
+                    "       %s [-k mismatches | -t | -r] [-j threads] "
+                    "[--time-budget seconds] -b manifest\n"
+                    "       %s --store file file\n"
+                    "       %s --index file file\n",
+            prog, prog, prog, prog);
+    exit(1);
+}
+
+/*
+ * Use the command-line argument as a file path.
+ * Open and read all fragments from that file.
+ * On error, close the file and exit.
+ * Print the assembled solution to the console.
+ * With -b, reassemble every file listed in the manifest instead.
+ */
+int main(int argc, char *argv[])
+{
+    char *frags[MAX_FRAG_COUNT];
+    char *manifest = NULL, *store = NULL, *index_path = NULL, *result;
+    int n_frags, opt, n_threads = 0;
+    reassemble_opts opts = {0};
+    static const struct option long_opts[] = {
+        {"time-budget", required_argument, NULL, 'T'},
+        {"checkpoint", required_argument, NULL, 'C'},
+        {"store", required_argument, NULL, 'S'},
+        {"index", required_argument, NULL, 'I'},
+        {NULL, 0, NULL, 0},
+    };
+
+    while ((opt = getopt_long(argc, argv, "k:trb:j:", long_opts, NULL)) != -1) {
+        if (opt == 'k' && (opts.max_mismatches = atoi(optarg)) >= 0) {
+            continue;
+        }
+        if (opt == 't') {
+            opts.tiled = 1;
+            continue;
+        }
+        if (opt == 'r') {
+            opts.rounds = 1;
+            continue;
+        }
+        if (opt == 'b') {
+            manifest = optarg;
+            continue;
+        }
+        if (opt == 'j' && (n_threads = atoi(optarg)) > 0 &&
+            n_threads <= MAX_BATCH_THREADS) {
+            continue;
+        }
+        if (opt == 'T' && (opts.time_budget = atof(optarg)) > 0) {
+            continue;
+        }
+        if (opt == 'C') {
+            opts.checkpoint = optarg;
+            continue;
+        }
+        if (opt == 'S') {
+            store = optarg;
+            continue;
+        }
+        if (opt == 'I') {
+            index_path = optarg;
+            continue;
+        }
+        usage(argv[0]);
+    }
+    if (opts.tiled + opts.rounds + (opts.max_mismatches > 0) > 1) {
+        fprintf(stderr, "-k, -t and -r exclude each other.\n");
+        usage(argv[0]);
+    }
+    if (opts.max_mismatches > 0 &&
+        (opts.time_budget > 0 || opts.checkpoint != NULL)) {
+        fprintf(stderr, "-k takes neither --time-budget nor --checkpoint.\n");
+        exit(1);
+    }
+    if (manifest != NULL && opts.checkpoint != NULL) {
+        fprintf(stderr, "-b does not take --checkpoint.\n");
         exit(1);
     }
-    reassemble(frags, n_frags);
-    printf("%s\n", frags[0]);
-    free(frags[0]);
+    if ((store != NULL || index_path != NULL) &&
+        (opts.max_mismatches > 0 || opts.tiled || opts.rounds ||
+         manifest != NULL || opts.time_budget > 0 || opts.checkpoint != NULL ||
+         (store != NULL && index_path != NULL))) {
+        fprintf(stderr, "--store and --index take no other option.\n");
+        exit(1);
+    }
+    if (n_threads == 0) {
+        n_threads = sysconf(_SC_NPROCESSORS_ONLN);
+        if (n_threads < 1 || n_threads > MAX_BATCH_THREADS) {
+            n_threads = n_threads < 1 ? 1 : MAX_BATCH_THREADS;
+        }
+    }
+    if (manifest != NULL) {
+        opts.n_threads = 1; // the threads work on files, not rounds
+        return reassemble_batch(manifest, n_threads, &opts) > 0;
+    }
+    opts.n_threads = n_threads;
+    if (optind == argc) {
+        fprintf(stderr, "You must specify a filename argument.\n");
+        exit(1);
+    }
+    if (argc - optind > 1) {
+       fprintf(stderr, "Ignoring excess arguments...\n");
+    }
+    // always take the first argument
+    if (store != NULL) {
+        return reassemble_external(argv[optind], store) < 0;
+    }
+    if (index_path != NULL) {
+        return reassemble_incremental(argv[optind], index_path) < 0;
+    }
+    result = reassemble_file(argv[optind], frags, &opts, &n_frags);
+    if (result == NULL) {
+        exit(1);
+    }
+    printf("%s\n", result);
+    free(result);
     return 0;
-}
\ No newline at end of file
+}
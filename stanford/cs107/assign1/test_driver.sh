@@ -1,7 +1,7 @@
 #/bin/bash -x
 
 TEST_DIR=test_set
-N_TESTS=15
+N_TESTS=16
 ERROR_FLAG=0
 
 make
@@ -16,6 +16,117 @@ do
     fi
 done
 
+# Approximate mode, on fragments with typos, and with insertions and
+# deletions as well
+for i in 1 2;
+do
+    ./reassemble -k 2 $TEST_DIR/approx$i.txt > $TEST_DIR/approx$i.out 2>&1
+    diff $TEST_DIR/approx$i.out $TEST_DIR/approx$i.ref
+    if [ $? -ne 0 ]; then
+        printf "$TEST_DIR/approx$i.txt input file did not pass.\n"
+        ERROR_FLAG=1
+    fi
+done
+
+# Tiled mode, on every test that reassembles successfully
+VALID_TESTS="1 3 6 7 8 9 10 11 12 13 14 15 16"
+for i in $VALID_TESTS;
+do
+    ./reassemble -t $TEST_DIR/test$i.txt 2> /dev/null | diff - $TEST_DIR/test$i.ref
+    if [ $? -ne 0 ]; then
+        printf "$TEST_DIR/test$i.txt input file did not pass in tiled mode.\n"
+        ERROR_FLAG=1
+    fi
+done
+
+# Round mode, on every test that reassembles successfully
+for i in $VALID_TESTS;
+do
+    ./reassemble -r -j 2 $TEST_DIR/test$i.txt 2> /dev/null | diff - $TEST_DIR/test$i.ref
+    if [ $? -ne 0 ]; then
+        printf "$TEST_DIR/test$i.txt input file did not pass in round mode.\n"
+        ERROR_FLAG=1
+    fi
+done
+
+# A checkpointed run that finishes gives the same result and removes it
+./reassemble --checkpoint $TEST_DIR/test8.ckpt $TEST_DIR/test8.txt | diff - $TEST_DIR/test8.ref
+if [ $? -ne 0 ] || [ -e $TEST_DIR/test8.ckpt ]; then
+    printf "$TEST_DIR/test8.txt input file did not pass with a checkpoint.\n"
+    ERROR_FLAG=1
+fi
+
+# A run stopped by its time budget resumes from its checkpoint, in exact
+# and in tiled mode
+for MODE in "" "-t";
+do
+    rm -f $TEST_DIR/test16.ckpt
+    ./reassemble $MODE --time-budget 0.000001 --checkpoint $TEST_DIR/test16.ckpt $TEST_DIR/test16.txt > /dev/null 2>&1
+    if [ ! -e $TEST_DIR/test16.ckpt ]; then
+        printf "$TEST_DIR/test16.txt input file left no checkpoint $MODE.\n"
+        ERROR_FLAG=1
+    fi
+    ./reassemble $MODE --checkpoint $TEST_DIR/test16.ckpt $TEST_DIR/test16.txt 2> /dev/null | diff - $TEST_DIR/test16.ref
+    if [ $? -ne 0 ] || [ -e $TEST_DIR/test16.ckpt ]; then
+        printf "$TEST_DIR/test16.txt input file did not pass resumed $MODE.\n"
+        ERROR_FLAG=1
+    fi
+done
+
+# Out-of-core mode, on every test it reassembles into one contig
+STORE_TESTS="1 3 6 7 8 9 10 12 13 14 15 16"
+for i in $STORE_TESTS;
+do
+    ./reassemble --store $TEST_DIR/test$i.store $TEST_DIR/test$i.txt | diff - $TEST_DIR/test$i.ref
+    if [ $? -ne 0 ] || [ -e $TEST_DIR/test$i.store ]; then
+        printf "$TEST_DIR/test$i.txt input file did not pass out of core.\n"
+        ERROR_FLAG=1
+    fi
+done
+
+# Incremental mode: half of test16, then the other half added to it
+N_LINES=$(wc -l < $TEST_DIR/test16.txt)
+head -n $((N_LINES / 2)) $TEST_DIR/test16.txt > $TEST_DIR/test16a.txt
+tail -n +$((N_LINES / 2 + 1)) $TEST_DIR/test16.txt > $TEST_DIR/test16b.txt
+rm -f $TEST_DIR/test16.index
+./reassemble --index $TEST_DIR/test16.index $TEST_DIR/test16a.txt > /dev/null 2>&1
+./reassemble --index $TEST_DIR/test16.index $TEST_DIR/test16b.txt 2> /dev/null | diff - $TEST_DIR/test16.ref
+if [ $? -ne 0 ]; then
+    printf "$TEST_DIR/test16.txt input file did not pass incrementally.\n"
+    ERROR_FLAG=1
+fi
+rm -f $TEST_DIR/test16a.txt $TEST_DIR/test16b.txt $TEST_DIR/test16.index
+
+# Gzip compressed input
+./reassemble $TEST_DIR/test8.txt.gz | diff - $TEST_DIR/test8.ref
+if [ $? -ne 0 ]; then
+    printf "$TEST_DIR/test8.txt.gz input file did not pass.\n"
+    ERROR_FLAG=1
+fi
+
+# Batch mode, on every test that reassembles successfully
+BATCH_TESTS=$VALID_TESTS
+rm -f $TEST_DIR/manifest.txt
+for i in $BATCH_TESTS;
+do
+    echo $TEST_DIR/test$i.txt >> $TEST_DIR/manifest.txt
+    rm -f $TEST_DIR/test$i.out
+done
+./reassemble -j 4 -b $TEST_DIR/manifest.txt > /dev/null
+if [ $? -ne 0 ]; then
+    printf "Batch of $TEST_DIR/manifest.txt did not pass.\n"
+    ERROR_FLAG=1
+fi
+for i in $BATCH_TESTS;
+do
+    diff $TEST_DIR/test$i.out $TEST_DIR/test$i.ref
+    if [ $? -ne 0 ]; then
+        printf "$TEST_DIR/test$i.txt input file did not pass in batch.\n"
+        ERROR_FLAG=1
+    fi
+done
+rm -f $TEST_DIR/manifest.txt
+
 if [ $ERROR_FLAG -ne 0 ]; then
     printf "Not all tests passed.\n"
 else
@@ -0,0 +1,117 @@
+/*
+ * Unit test for CAppendVector.
+ * Several producers append at once while a reader follows the published
+ * count. Every element must then be found exactly once, and each
+ * producer's elements in the order it appended them.
+ *
+ * Author:
+ * Elizabeth Howe
+ */
+
+#include <assert.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include "cappendvector.h"
+
+enum {
+    N_PRODUCERS = 4,
+    N_APPENDS = 100000, // per producer
+};
+
+typedef struct {
+    int producer;
+    int seq;
+} record;
+
+typedef struct {
+    CAppendVector *av;
+    int producer;
+} producer_arg;
+
+static int n_freed;
+
+static void count_free(void *addr)
+{
+    (void)addr;
+    n_freed++;
+}
+
+static void *produce(void *arg)
+{
+    producer_arg *p = arg;
+    record r, *stored;
+    int i, index;
+
+    r.producer = p->producer;
+    for (i = 0; i < N_APPENDS; i++) {
+        r.seq = i;
+        index = cappend_append(p->av, &r);
+        // An earlier slot may still be in progress, holding back the count
+        if (index < cappend_count(p->av)) {
+            stored = cappend_nth(p->av, index);
+            assert(stored->producer == r.producer && stored->seq == i);
+        }
+    }
+    return NULL;
+}
+
+/* Check that every published element is complete, until all are */
+static void *read_published(void *arg)
+{
+    CAppendVector *av = arg;
+    record *r;
+    int i = 0, count;
+
+    do {
+        count = cappend_count(av);
+        for (; i < count; i++) {
+            r = cappend_nth(av, i);
+            assert(r->producer >= 0 && r->producer < N_PRODUCERS);
+            assert(r->seq >= 0 && r->seq < N_APPENDS);
+        }
+    } while (count < N_PRODUCERS * N_APPENDS);
+    return NULL;
+}
+
+int main(void)
+{
+    CAppendVector *av;
+    CVector *cv;
+    pthread_t producers[N_PRODUCERS], reader;
+    producer_arg args[N_PRODUCERS];
+    int next_seq[N_PRODUCERS] = {0};
+    record *r;
+    int i;
+
+    av = cappend_create(sizeof(record), 16, count_free);
+    assert(pthread_create(&reader, NULL, read_published, av) == 0);
+    for (i = 0; i < N_PRODUCERS; i++) {
+        args[i].av = av;
+        args[i].producer = i;
+        assert(pthread_create(&producers[i], NULL, produce, &args[i]) == 0);
+    }
+    for (i = 0; i < N_PRODUCERS; i++) {
+        pthread_join(producers[i], NULL);
+    }
+    pthread_join(reader, NULL);
+    assert(cappend_count(av) == N_PRODUCERS * N_APPENDS);
+
+    cv = cappend_freeze(av);
+    assert(cvec_count(cv) == N_PRODUCERS * N_APPENDS);
+    for (i = 0; i < cvec_count(cv); i++) {
+        r = cvec_nth(cv, i);
+        assert(r->producer >= 0 && r->producer < N_PRODUCERS);
+        assert(r->seq == next_seq[r->producer]);
+        next_seq[r->producer]++;
+    }
+    for (i = 0; i < N_PRODUCERS; i++) {
+        assert(next_seq[i] == N_APPENDS);
+    }
+    assert(n_freed == 0);
+    cvec_dispose(cv);
+    assert(n_freed == N_PRODUCERS * N_APPENDS);
+    printf("%d producers appended %d elements, all found in order.\n",
+           N_PRODUCERS, N_PRODUCERS * N_APPENDS);
+    return 0;
+}
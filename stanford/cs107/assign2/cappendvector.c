@@ -0,0 +1,209 @@
+/*
+ * Implementation of the CAppendVector API.
+ * Chunk k holds first_length << k elements, so that element i is found
+ * from the position of the highest set bit of i + first_length, and the
+ * chunk pointers fit in a small fixed array. A chunk is allocated by the
+ * first thread to reserve a slot in it; if two threads race, the loser of
+ * the compare-and-swap frees its copy.
+ *
+ * Each slot has a ready flag, set once its element is copied in. The
+ * published count then advances over ready slots by compare-and-swap,
+ * helped along by every appender, so a slow appender holds back the
+ * published count but never blocks the others.
+ * The flags and the count use sequentially consistent atomics: an
+ * appender that marks its slot ready and then finds the slot before it
+ * not ready yet relies on the appender of that slot to see its flag.
+ *
+ * Author:
+ * Elizabeth Howe
+ *
+ * Reference:
+ * Stanford CS107
+ */
+
+#include "cappendvector.h"
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+
+static const int default_first_length = 16;
+
+#define MAX_CHUNKS 40
+
+/* A chunk: the elements, then one ready flag per element */
+typedef struct {
+    char *elems;
+    char *ready;
+} Chunk;
+
+/* Define the CAppendVector internals */
+typedef struct CAppendVector_internals {
+    Chunk *chunks[MAX_CHUNKS]; // allocated on demand, never moved
+    size_t elem_size;
+    size_t first_length; // a power of two
+    int first_shift; // log2 of first_length
+    int reserved; // slots handed out to appenders
+    int published; // slots fully written, in index order
+    free_fun clean; // cleanup function
+} CAppendVector;
+
+CAppendVector *cappend_create(size_t elem_size, size_t capacity_hint, free_fun fn)
+{
+    assert(elem_size != 0);
+
+    CAppendVector *av = calloc(1, sizeof(CAppendVector));
+    assert(av != NULL);
+
+    av->elem_size = elem_size;
+    if (capacity_hint == 0) {
+        capacity_hint = default_first_length;
+    }
+    av->first_length = 1;
+    while (av->first_length < capacity_hint) {
+        av->first_length <<= 1;
+        av->first_shift++;
+    }
+    av->clean = fn;
+    return av;
+}
+
+/* Find the chunk and the offset in it of element index */
+static void locate(const CAppendVector *av, int index, int *chunk, size_t *offset)
+{
+    size_t position = (size_t)index + av->first_length;
+    int high_bit = 63 - __builtin_clzll(position);
+
+    *chunk = high_bit - av->first_shift;
+    *offset = position - ((size_t)1 << high_bit);
+}
+
+static size_t chunk_length(const CAppendVector *av, int chunk)
+{
+    return av->first_length << chunk;
+}
+
+/* Return chunk k, allocating it if no thread has yet */
+static Chunk *get_chunk(CAppendVector *av, int k)
+{
+    Chunk *chunk, *expected = NULL;
+
+    chunk = __atomic_load_n(&av->chunks[k], __ATOMIC_ACQUIRE);
+    if (chunk != NULL) {
+        return chunk;
+    }
+    chunk = malloc(sizeof(Chunk));
+    assert(chunk != NULL);
+    chunk->elems = malloc(chunk_length(av, k) * av->elem_size);
+    chunk->ready = calloc(chunk_length(av, k), 1);
+    assert(chunk->elems != NULL && chunk->ready != NULL);
+    if (!__atomic_compare_exchange_n(&av->chunks[k], &expected, chunk, false,
+                                     __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)) {
+        free(chunk->elems);
+        free(chunk->ready);
+        free(chunk);
+        chunk = expected; // another thread's chunk won
+    }
+    return chunk;
+}
+
+static bool is_ready(const CAppendVector *av, int index)
+{
+    int k;
+    size_t offset;
+    Chunk *chunk;
+
+    locate(av, index, &k, &offset);
+    chunk = __atomic_load_n(&av->chunks[k], __ATOMIC_SEQ_CST);
+    return chunk != NULL &&
+           __atomic_load_n(&chunk->ready[offset], __ATOMIC_SEQ_CST);
+}
+
+/* Advance the published count over the slots that are ready */
+static void publish(CAppendVector *av)
+{
+    int count = __atomic_load_n(&av->published, __ATOMIC_SEQ_CST);
+
+    while (count < __atomic_load_n(&av->reserved, __ATOMIC_SEQ_CST) &&
+           is_ready(av, count)) {
+        // On failure count is reloaded, someone else moved it on
+        __atomic_compare_exchange_n(&av->published, &count, count + 1, false,
+                                    __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST);
+    }
+}
+
+int cappend_append(CAppendVector *av, const void *addr)
+{
+    int index, k;
+    size_t offset;
+    Chunk *chunk;
+
+    index = __atomic_fetch_add(&av->reserved, 1, __ATOMIC_SEQ_CST);
+    assert(index >= 0); // no int overflow
+    locate(av, index, &k, &offset);
+    assert(k < MAX_CHUNKS);
+    chunk = get_chunk(av, k);
+    memcpy(chunk->elems + offset * av->elem_size, addr, av->elem_size);
+    __atomic_store_n(&chunk->ready[offset], 1, __ATOMIC_SEQ_CST);
+    publish(av);
+    return index;
+}
+
+int cappend_count(const CAppendVector *av)
+{
+    return __atomic_load_n(&av->published, __ATOMIC_SEQ_CST);
+}
+
+void *cappend_nth(const CAppendVector *av, int index)
+{
+    int k;
+    size_t offset;
+    Chunk *chunk;
+
+    assert(index >= 0 && index < cappend_count(av));
+    locate(av, index, &k, &offset);
+    chunk = __atomic_load_n(&av->chunks[k], __ATOMIC_ACQUIRE);
+    return chunk->elems + offset * av->elem_size;
+}
+
+/* Free the storage, leaving the elements' resources alone */
+static void free_chunks(CAppendVector *av)
+{
+    int k;
+
+    for (k = 0; k < MAX_CHUNKS; k++) {
+        if (av->chunks[k] != NULL) {
+            free(av->chunks[k]->elems);
+            free(av->chunks[k]->ready);
+            free(av->chunks[k]);
+        }
+    }
+    free(av);
+}
+
+void cappend_dispose(CAppendVector *av)
+{
+    int i;
+
+    if (av->clean != NULL) {
+        for (i = 0; i < av->published; i++) {
+            (av->clean)(cappend_nth(av, i));
+        }
+    }
+    free_chunks(av);
+}
+
+CVector *cappend_freeze(CAppendVector *av)
+{
+    int i;
+    CVector *cv;
+
+    assert(av->published == av->reserved);
+
+    cv = cvec_create(av->elem_size, av->published == 0 ? 1 : av->published,
+                     av->clean);
+    for (i = 0; i < av->published; i++) {
+        cvec_append(cv, cappend_nth(av, i));
+    }
+    free_chunks(av);
+    return cv;
+}
@@ -0,0 +1,77 @@
+/*
+ * CAppendVector API.
+ *
+ * Motivation:
+ * Threads producing results in parallel, such as per-worker corrections,
+ * otherwise need a mutex around cvec_append. The CAppendVector is an
+ * append-only vector that any number of threads can append to and read
+ * from at once, without locks.
+ * An append reserves a slot with one atomic fetch-and-add. Slots live in
+ * chunks that double in size and never move, so a reserved slot stays
+ * valid while other threads keep appending.
+ * Once the producers are done, cappend_freeze turns it into a normal
+ * contiguous CVector.
+ *
+ * Author:
+ * Elizabeth Howe
+ */
+
+#ifndef _cappendvector_h
+#define _cappendvector_h
+
+#include "cvector.h"
+
+/* Define the CAppendVector type. */
+typedef struct CAppendVector_internals CAppendVector;
+
+/*
+ * Create a dynamically-allocated empty CAppendVector and return a pointer
+ * to it.
+ * O(1) time.
+ *
+ * elemsz specifies the size, in bytes, of the elements.
+ * capacity_hint is the size of the first chunk; later chunks double.
+ * fn is the cleanup function for an element, as for cvec_create.
+ * It is called by cappend_dispose, or by the CVector after cappend_freeze.
+ */
+CAppendVector *cappend_create(size_t elemsz, size_t capacity_hint, free_fun fn);
+
+/*
+ * Call the client's cleanup function on each element and deallocate all
+ * memory used for the CAppendVector's storage.
+ * Must not be called while other threads use the CAppendVector.
+ * O(N) time.
+ */
+void cappend_dispose(CAppendVector *av);
+
+/*
+ * Append a copy of the element at addr. Safe to call from many threads
+ * at once. Return the index of the new element.
+ * O(1) time, plus allocating a chunk once per doubling.
+ */
+int cappend_append(CAppendVector *av, const void *addr);
+
+/*
+ * Return the number of published elements. Elements are published in
+ * index order: every element below the count has been fully copied in,
+ * even if some appends of later elements are still in progress.
+ * O(1) time.
+ */
+int cappend_count(const CAppendVector *av);
+
+/*
+ * Return a pointer to the published element at position index.
+ * Safe to call while other threads append.
+ * O(1) time.
+ */
+void *cappend_nth(const CAppendVector *av, int index);
+
+/*
+ * Move the elements, in index order, into a new contiguous CVector and
+ * deallocate the CAppendVector. The CVector takes over the cleanup
+ * function. Must be called after all appends have returned.
+ * O(N) time.
+ */
+CVector *cappend_freeze(CAppendVector *av);
+
+#endif
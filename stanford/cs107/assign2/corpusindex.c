@@ -0,0 +1,477 @@
+/*
+ * Implementation of the CorpusIndex API.
+ * The index is one contiguous block of memory consisting of:
+ * 1. a header, giving the sizes and the offsets of the parts below
+ * 2. the letter histogram of each word, in the order of the entries
+ * 3. an array of entries sorted by word, each an offset into the text and
+ *    a frequency
+ * 4. the best-first order: the positions of the words sorted by first
+ *    letter, then length, then frequency, most frequent first
+ * 5. the text, every word followed by its '\0'
+ * The header is a multiple of 16 bytes, so the histograms are aligned for
+ * vector loads.
+ * All offsets are from the start of the block, so the block can be copied
+ * into a shared-memory segment as is and read at whatever address each
+ * process maps it.
+ *
+ * A loader writes the magic number last, so a worker that attaches while
+ * the segment is still being filled in finds no magic number and refuses
+ * it, rather than reading half an index.
+ *
+ * Author:
+ * Elizabeth Howe
+ */
+
+#include "corpusindex.h"
+#include "letterhist.h"
+#include <assert.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+static const char index_magic[8] = "CORPIDX";
+
+enum {
+    INDEX_VERSION = 3,
+};
+
+typedef struct {
+    uint32_t word; // offset of the word in the text
+    int32_t freq;
+} Entry;
+
+/* Define the CorpusIndex internals, at the start of the block */
+typedef struct CorpusIndex_header {
+    char magic[8];
+    uint32_t version;
+    uint32_t n_words;
+    uint64_t size; // bytes in the whole block
+    uint64_t hists; // offset of the histograms
+    uint64_t entries; // offset of the Entry array
+    uint64_t order; // offset of the best-first positions
+    uint64_t text; // offset of the text
+    uint64_t unused; // pads the header to 64 bytes
+} CorpusIndex;
+
+/* The sort key of a word in the best-first order */
+typedef struct {
+    unsigned char first;
+    int len;
+    int freq;
+    uint32_t position;
+} OrderKey;
+
+static unsigned char *get_hists(const CorpusIndex *ci)
+{
+    return (unsigned char *)ci + ci->hists;
+}
+
+static const Entry *get_entries(const CorpusIndex *ci)
+{
+    return (const Entry *)((const char *)ci + ci->entries);
+}
+
+static uint32_t *get_order(const CorpusIndex *ci)
+{
+    return (uint32_t *)((char *)ci + ci->order);
+}
+
+static const char *get_text(const CorpusIndex *ci)
+{
+    return (const char *)ci + ci->text;
+}
+
+/* Allocate a block for n_words words of text_size bytes in all */
+static CorpusIndex *index_alloc(int n_words, size_t text_size)
+{
+    CorpusIndex *ci;
+    size_t size;
+
+    size = sizeof(CorpusIndex) +
+           n_words * (LHIST_SIZE + sizeof(Entry) + sizeof(uint32_t)) + text_size;
+    ci = calloc(1, size);
+    assert(ci != NULL);
+    memcpy(ci->magic, index_magic, sizeof(index_magic));
+    ci->version = INDEX_VERSION;
+    ci->n_words = n_words;
+    ci->size = size;
+    ci->hists = sizeof(CorpusIndex);
+    ci->entries = ci->hists + n_words * LHIST_SIZE;
+    ci->order = ci->entries + n_words * sizeof(Entry);
+    ci->text = ci->order + n_words * sizeof(uint32_t);
+    return ci;
+}
+
+static int cmp_order_key(const void *p1, const void *p2)
+{
+    const OrderKey *k1 = p1, *k2 = p2;
+
+    if (k1->first != k2->first) {
+        return k1->first - k2->first;
+    }
+    if (k1->len != k2->len) {
+        return k1->len - k2->len;
+    }
+    if (k1->freq != k2->freq) {
+        return k1->freq < k2->freq ? 1 : -1;
+    }
+    return k1->position < k2->position ? -1 : 1;
+}
+
+/* Fill in the best-first order of an index whose entries are filled in */
+static void index_order(CorpusIndex *ci)
+{
+    uint32_t i;
+    const char *word;
+    OrderKey *keys;
+
+    keys = malloc((ci->n_words + 1) * sizeof(OrderKey));
+    assert(keys != NULL);
+    for (i = 0; i < ci->n_words; i++) {
+        word = cindex_word(ci, i);
+        keys[i].first = word[0];
+        keys[i].len = strlen(word);
+        keys[i].freq = cindex_freq(ci, i);
+        keys[i].position = i;
+    }
+    qsort(keys, ci->n_words, sizeof(OrderKey), cmp_order_key);
+    for (i = 0; i < ci->n_words; i++) {
+        get_order(ci)[i] = keys[i].position;
+    }
+    free(keys);
+}
+
+static int cmp_word_ptr(const void *p1, const void *p2)
+{
+    return strcmp(*(const char **)p1, *(const char **)p2);
+}
+
+CorpusIndex *cindex_from_map(const CMap *corpus_map)
+{
+    int i, n_words, freq;
+    size_t text_size, len;
+    const char *word, **words;
+    CorpusIndex *ci;
+    Entry *entries;
+    char *text;
+
+    n_words = cmap_count(corpus_map);
+    words = malloc((n_words + 1) * sizeof(char *));
+    assert(words != NULL);
+    text_size = 0;
+    i = 0;
+    for (word = cmap_first(corpus_map); word != NULL;
+         word = cmap_next(corpus_map, word)) {
+        words[i++] = word;
+        text_size += strlen(word) + 1;
+    }
+    qsort(words, n_words, sizeof(char *), cmp_word_ptr);
+
+    ci = index_alloc(n_words, text_size);
+    entries = (Entry *)get_entries(ci);
+    text = (char *)get_text(ci);
+    text_size = 0;
+    for (i = 0; i < n_words; i++) {
+        len = strlen(words[i]) + 1;
+        memcpy(text + text_size, words[i], len);
+        entries[i].word = text_size;
+        lhist_count(words[i], get_hists(ci) + i * LHIST_SIZE);
+        // CMap values are not aligned
+        memcpy(&freq, cmap_get(corpus_map, words[i]), sizeof(int));
+        entries[i].freq = freq;
+        text_size += len;
+    }
+    free(words);
+    index_order(ci);
+    return ci;
+}
+
+/*
+ * Read the next "word count" line from fp into *line, and split it.
+ * Return false at the end of the file, or if the line is malformed.
+ */
+static bool read_count(FILE *fp, char **line, size_t *capacity, char **word,
+                       int *freq)
+{
+    ssize_t len;
+    long count;
+    char *space, *end;
+
+    len = getline(line, capacity, fp);
+    if (len <= 0 || (*line)[len - 1] != '\n') {
+        return false;
+    }
+    (*line)[len - 1] = '\0';
+    space = strchr(*line, ' ');
+    if (space == NULL || space == *line) {
+        return false;
+    }
+    *space = '\0';
+    count = strtol(space + 1, &end, 10);
+    if (*end != '\0' || count < 1 || count > INT_MAX) {
+        return false;
+    }
+    *word = *line;
+    *freq = count;
+    return true;
+}
+
+CorpusIndex *cindex_from_counts(FILE *fp)
+{
+    int i, n_words, freq;
+    size_t text_size, len, capacity;
+    char *line, *word, *prev;
+    CorpusIndex *ci;
+    Entry *entries;
+    char *text;
+
+    if (fseek(fp, 0, SEEK_SET) != 0) {
+        return NULL;
+    }
+    // First pass: check the order and size the index
+    line = NULL;
+    capacity = 0;
+    prev = NULL;
+    n_words = 0;
+    text_size = 0;
+    while (read_count(fp, &line, &capacity, &word, &freq)) {
+        if (prev != NULL && strcmp(prev, word) >= 0) {
+            break;
+        }
+        free(prev);
+        prev = strdup(word);
+        assert(prev != NULL);
+        n_words++;
+        text_size += strlen(word) + 1;
+    }
+    free(prev);
+    if (!feof(fp) || ferror(fp) || n_words == INT_MAX ||
+        fseek(fp, 0, SEEK_SET) != 0) {
+        free(line);
+        return NULL;
+    }
+
+    ci = index_alloc(n_words, text_size);
+    entries = (Entry *)get_entries(ci);
+    text = (char *)get_text(ci);
+    text_size = 0;
+    for (i = 0; i < n_words; i++) {
+        if (!read_count(fp, &line, &capacity, &word, &freq)) {
+            free(line);
+            free(ci);
+            return NULL; // changed under us
+        }
+        len = strlen(word) + 1;
+        memcpy(text + text_size, word, len);
+        entries[i].word = text_size;
+        entries[i].freq = freq;
+        lhist_count(word, get_hists(ci) + i * LHIST_SIZE);
+        text_size += len;
+    }
+    free(line);
+    index_order(ci);
+    return ci;
+}
+
+void cindex_dispose(CorpusIndex *ci)
+{
+    free(ci);
+}
+
+int cindex_count(const CorpusIndex *ci)
+{
+    return ci->n_words;
+}
+
+const char *cindex_word(const CorpusIndex *ci, int index)
+{
+    assert(index >= 0 && index < (int)ci->n_words);
+    return get_text(ci) + get_entries(ci)[index].word;
+}
+
+int cindex_freq(const CorpusIndex *ci, int index)
+{
+    assert(index >= 0 && index < (int)ci->n_words);
+    return get_entries(ci)[index].freq;
+}
+
+const unsigned char *cindex_hists(const CorpusIndex *ci)
+{
+    return get_hists(ci);
+}
+
+/* Return true if the word at position is before (first, len) in the order */
+static bool is_before(const CorpusIndex *ci, uint32_t position,
+                      unsigned char first, int len)
+{
+    const char *word = cindex_word(ci, position);
+
+    if ((unsigned char)word[0] != first) {
+        return (unsigned char)word[0] < first;
+    }
+    return (int)strlen(word) < len;
+}
+
+int cindex_candidates(const CorpusIndex *ci, char first, int len,
+                      const uint32_t **positions)
+{
+    int low, high, mid, begin;
+    const uint32_t *order = get_order(ci);
+
+    // Find the first word not before (first, len), then the first after
+    low = 0;
+    high = ci->n_words;
+    while (low < high) {
+        mid = low + (high - low) / 2;
+        if (is_before(ci, order[mid], first, len)) {
+            low = mid + 1;
+        }
+        else {
+            high = mid;
+        }
+    }
+    begin = low;
+    high = ci->n_words;
+    while (low < high) {
+        mid = low + (high - low) / 2;
+        if (is_before(ci, order[mid], first, len + 1)) {
+            low = mid + 1;
+        }
+        else {
+            high = mid;
+        }
+    }
+    *positions = order + begin;
+    return low - begin;
+}
+
+int cindex_find(const CorpusIndex *ci, const char *word)
+{
+    int low, high, mid, cmp;
+
+    low = 0;
+    high = ci->n_words - 1;
+    while (low <= high) {
+        mid = low + (high - low) / 2;
+        cmp = strcmp(word, cindex_word(ci, mid));
+        if (cmp == 0) {
+            return mid;
+        }
+        if (cmp < 0) {
+            high = mid - 1;
+        }
+        else {
+            low = mid + 1;
+        }
+    }
+    return -1;
+}
+
+bool cindex_publish(const CorpusIndex *ci, const char *name)
+{
+    int fd;
+    char *p;
+
+    // Workers still attached to an old segment keep their mapping
+    if (shm_unlink(name) != 0 && errno != ENOENT) {
+        perror(name);
+        return false;
+    }
+    fd = shm_open(name, O_CREAT | O_EXCL | O_RDWR, 0644);
+    if (fd < 0) {
+        perror(name);
+        return false;
+    }
+    if (ftruncate(fd, ci->size) != 0) {
+        perror(name);
+        close(fd);
+        shm_unlink(name);
+        return false;
+    }
+    p = mmap(NULL, ci->size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (p == MAP_FAILED) {
+        perror(name);
+        shm_unlink(name);
+        return false;
+    }
+    memcpy(p + sizeof(ci->magic), (const char *)ci + sizeof(ci->magic),
+           ci->size - sizeof(ci->magic));
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+    memcpy(p, ci->magic, sizeof(ci->magic));
+    munmap(p, ci->size);
+    return true;
+}
+
+/* Return true if the block of size bytes at ci holds a whole index */
+static bool is_complete(const CorpusIndex *ci, size_t size)
+{
+    if (size < sizeof(CorpusIndex) ||
+        memcmp(ci->magic, index_magic, sizeof(index_magic)) != 0) {
+        return false;
+    }
+    __atomic_thread_fence(__ATOMIC_ACQUIRE);
+    return ci->version == INDEX_VERSION && ci->size == size &&
+           ci->hists == sizeof(CorpusIndex) &&
+           ci->entries == ci->hists + ci->n_words * LHIST_SIZE &&
+           ci->order == ci->entries + ci->n_words * sizeof(Entry) &&
+           ci->text == ci->order + ci->n_words * sizeof(uint32_t) &&
+           ci->text <= size &&
+           (ci->n_words == 0 || ((const char *)ci)[size - 1] == '\0');
+}
+
+const CorpusIndex *cindex_attach(const char *name)
+{
+    int fd;
+    struct stat st;
+    void *p;
+
+    fd = shm_open(name, O_RDONLY, 0);
+    if (fd < 0) {
+        perror(name);
+        return NULL;
+    }
+    if (fstat(fd, &st) != 0) {
+        perror(name);
+        close(fd);
+        return NULL;
+    }
+    if ((size_t)st.st_size < sizeof(CorpusIndex)) {
+        fprintf(stderr, "%s: not a corpus index\n", name);
+        close(fd);
+        return NULL;
+    }
+    p = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (p == MAP_FAILED) {
+        perror(name);
+        return NULL;
+    }
+    if (!is_complete(p, st.st_size)) {
+        fprintf(stderr, "%s: not a corpus index\n", name);
+        munmap(p, st.st_size);
+        return NULL;
+    }
+    return p;
+}
+
+void cindex_detach(const CorpusIndex *ci)
+{
+    munmap((void *)ci, ci->size);
+}
+
+bool cindex_unlink(const char *name)
+{
+    if (shm_unlink(name) != 0) {
+        perror(name);
+        return false;
+    }
+    return true;
+}
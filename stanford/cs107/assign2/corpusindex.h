@@ -0,0 +1,130 @@
+/*
+ * CorpusIndex API.
+ *
+ * Motivation:
+ * Every spellcheck process used to build its own CMap of the corpus. On a
+ * host running many workers that is one private copy of the corpus per
+ * worker, and each worker spends its startup reading and hashing it.
+ * A CorpusIndex is the corpus as one flat, read-only block: the distinct
+ * words sorted alphabetically, each with its frequency and its letter
+ * histogram, and a best-first order in which to try them as corrections.
+ * The block holds offsets rather than pointers, so it means the same thing
+ * at any address.
+ * One loader can then publish it as a POSIX shared-memory segment, and
+ * workers attach to the segment read-only: the pages are shared by every
+ * worker, and attaching costs a single mmap.
+ *
+ * Authors:
+ * Elizabeth Howe
+ */
+
+#ifndef _corpusindex_h
+#define _corpusindex_h
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include "cmap.h"
+
+/* Define the CorpusIndex type */
+typedef struct CorpusIndex_header CorpusIndex;
+
+/*
+ * Return a new dynamically-allocated CorpusIndex of the words in
+ * corpus_map, whose values are int frequencies.
+ * When done with it, client must call cindex_dispose.
+ * O(N log N) time.
+ */
+CorpusIndex *cindex_from_map(const CMap *corpus_map);
+
+/*
+ * Return a new dynamically-allocated CorpusIndex of a word count file: one
+ * "word count" line per word, in strcmp order, such as a WordCounter
+ * writes. fp must be seekable: it is read twice, from the start.
+ * When done with it, client must call cindex_dispose.
+ * Return NULL if the file is not such a word count file.
+ * O(N) time.
+ */
+CorpusIndex *cindex_from_counts(FILE *fp);
+
+/*
+ * Deallocate a CorpusIndex made by cindex_from_map or cindex_from_counts.
+ * O(1) time.
+ */
+void cindex_dispose(CorpusIndex *ci);
+
+/*
+ * Return the number of distinct words in the index.
+ * O(1) time.
+ */
+int cindex_count(const CorpusIndex *ci);
+
+/*
+ * Return the word at position index, in alphabetical order.
+ * O(1) time.
+ */
+const char *cindex_word(const CorpusIndex *ci, int index);
+
+/*
+ * Return the frequency of the word at position index.
+ * O(1) time.
+ */
+int cindex_freq(const CorpusIndex *ci, int index);
+
+/*
+ * Return the letter histograms of the words, LHIST_SIZE bytes each, back to
+ * back in index order, as made by lhist_count.
+ * O(1) time.
+ */
+const unsigned char *cindex_hists(const CorpusIndex *ci);
+
+/*
+ * Set *positions to the positions of the words that start with first and
+ * are len long, in best-first order: most frequent first, then
+ * alphabetical. Return how many there are.
+ * These are the likeliest corrections of a word with that first letter and
+ * length, so a leader board filled from them first prunes the rest early.
+ * O(log N) time.
+ */
+int cindex_candidates(const CorpusIndex *ci, char first, int len,
+                      const uint32_t **positions);
+
+/*
+ * Return the position of word in the index, or -1 if it is not there.
+ * O(log N) time.
+ */
+int cindex_find(const CorpusIndex *ci, const char *word);
+
+/*
+ * Copy the index into a new POSIX shared-memory segment called name,
+ * replacing any segment of that name. Attached workers keep the segment
+ * they mapped. The segment outlives the process, until cindex_unlink.
+ * Return false, after printing why, on error.
+ * O(N) time.
+ */
+bool cindex_publish(const CorpusIndex *ci, const char *name);
+
+/*
+ * Map the shared-memory segment called name read-only, and return the
+ * index in it. When done with it, client must call cindex_detach.
+ * Return NULL, after printing why, if there is no such segment or it does
+ * not hold a complete index.
+ * O(1) time.
+ */
+const CorpusIndex *cindex_attach(const char *name);
+
+/*
+ * Unmap an index returned by cindex_attach.
+ * O(1) time.
+ */
+void cindex_detach(const CorpusIndex *ci);
+
+/*
+ * Remove the shared-memory segment called name.
+ * Return false, after printing why, on error.
+ * O(1) time.
+ */
+bool cindex_unlink(const char *name);
+
+#endif
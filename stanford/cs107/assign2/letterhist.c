@@ -0,0 +1,85 @@
+/*
+ * Implementation of the letter histogram API.
+ * For each histogram, saturating byte subtraction against the query gives
+ * the surplus of each letter one way and the deficit the other way, and
+ * psadbw adds up eight bytes of each at a time. The bound is the larger of
+ * the two totals. Without SSE2 the same sums are taken a byte at a time.
+ *
+ * Author:
+ * Elizabeth Howe
+ */
+
+#include "letterhist.h"
+#include <string.h>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+void lhist_count(const char *word, unsigned char hist[LHIST_SIZE])
+{
+    int i;
+
+    memset(hist, 0, LHIST_SIZE);
+    for (i = 0; word[i] != '\0'; i++) {
+        if (word[i] >= 'a' && word[i] <= 'z' && hist[word[i] - 'a'] < 255) {
+            hist[word[i] - 'a']++;
+        }
+    }
+}
+
+static unsigned char saturate(int surplus, int deficit)
+{
+    int bound = surplus > deficit ? surplus : deficit;
+    return bound > 255 ? 255 : bound;
+}
+
+#ifdef __SSE2__
+
+void lhist_bounds(const unsigned char *hists, int n,
+                  const unsigned char query[LHIST_SIZE], unsigned char *bounds)
+{
+    int i;
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i q0 = _mm_loadu_si128((const __m128i *)query);
+    const __m128i q1 = _mm_loadu_si128((const __m128i *)(query + 16));
+    __m128i h0, h1, surplus, deficit, sums;
+
+    for (i = 0; i < n; i++, hists += LHIST_SIZE) {
+        h0 = _mm_loadu_si128((const __m128i *)hists);
+        h1 = _mm_loadu_si128((const __m128i *)(hists + 16));
+        // Each is two 64-bit halves, summing eight letters each
+        surplus = _mm_add_epi64(_mm_sad_epu8(_mm_subs_epu8(h0, q0), zero),
+                                _mm_sad_epu8(_mm_subs_epu8(h1, q1), zero));
+        deficit = _mm_add_epi64(_mm_sad_epu8(_mm_subs_epu8(q0, h0), zero),
+                                _mm_sad_epu8(_mm_subs_epu8(q1, h1), zero));
+        // Low half: total surplus, high half: total deficit
+        sums = _mm_add_epi64(_mm_unpacklo_epi64(surplus, deficit),
+                             _mm_unpackhi_epi64(surplus, deficit));
+        bounds[i] = saturate(_mm_cvtsi128_si32(sums),
+                             _mm_cvtsi128_si32(_mm_srli_si128(sums, 8)));
+    }
+}
+
+#else
+
+void lhist_bounds(const unsigned char *hists, int n,
+                  const unsigned char query[LHIST_SIZE], unsigned char *bounds)
+{
+    int i, j, surplus, deficit;
+
+    for (i = 0; i < n; i++, hists += LHIST_SIZE) {
+        surplus = 0;
+        deficit = 0;
+        for (j = 0; j < LHIST_SIZE; j++) {
+            if (hists[j] > query[j]) {
+                surplus += hists[j] - query[j];
+            }
+            else {
+                deficit += query[j] - hists[j];
+            }
+        }
+        bounds[i] = saturate(surplus, deficit);
+    }
+}
+
+#endif
@@ -0,0 +1,41 @@
+/*
+ * Letter histogram API.
+ *
+ * Motivation:
+ * Most corpus words are nowhere near a misspelling, yet the edit distance
+ * DP costs the product of the two lengths to say so. Counting letters gives
+ * a cheap lower bound instead. If word a has P more letters than word b,
+ * letter by letter, and N fewer, then every edit changes P or N by at most
+ * one, so the edit distance is at least max(P, N).
+ * A histogram holds one byte of count per letter a to z, padded to 32
+ * bytes, so the bound for a word is a handful of SSE2 instructions. The
+ * corpus index stores a histogram per word, and lhist_bounds computes the
+ * bounds of a whole block of them against one query.
+ *
+ * Author:
+ * Elizabeth Howe
+ */
+
+#ifndef _letterhist_h
+#define _letterhist_h
+
+/* Bytes in a histogram: a count for each of 'a' to 'z', then zeros */
+#define LHIST_SIZE 32
+
+/*
+ * Write the histogram of word to hist. Characters other than 'a' to 'z'
+ * are not counted, which only loosens the bound. Counts saturate at 255.
+ * O(N) time.
+ */
+void lhist_count(const char *word, unsigned char hist[LHIST_SIZE]);
+
+/*
+ * Write to bounds[i] the lower bound on the edit distance between the word
+ * of histogram query and the word of histogram i of the n histograms
+ * stored back to back at hists, saturated at 255.
+ * O(n) time.
+ */
+void lhist_bounds(const unsigned char *hists, int n,
+                  const unsigned char query[LHIST_SIZE], unsigned char *bounds);
+
+#endif
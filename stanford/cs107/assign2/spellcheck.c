@@ -18,23 +18,59 @@
  * 1. A corpus file
  * 2. Document file of input words or a single input word
  *
+ * Batching:
+ * All the misspellings of a document are checked in one walk over the
+ * corpus. They are sorted, so that each shares as long a prefix as
+ * possible with the one before it, like the paths of a prefix tree; the
+ * edit distance rows for a shared prefix are computed once per corpus
+ * word and reused by every misspelling that starts with it.
+ * Before the DP, the letter histograms of a block of corpus words are
+ * compared with each misspelling's. A corpus word whose bound on the edit
+ * distance is already worse than a full leader board cannot make it, and
+ * that misspelling skips it.
+ * To make those bounds tight early, each misspelling's leader board is
+ * first filled from the likeliest corrections: the corpus words of the same
+ * first letter and length, most frequent first. The DP itself stops as soon
+ * as a whole row is worse than the leader board. --stats prints how many
+ * candidates each stage pruned to stderr.
+ *
+ * Shared corpus:
+ * --load name corpus builds the corpus index into the POSIX shared-memory
+ * segment name and exits. --attach name what-to-check then checks against
+ * that segment instead of a corpus file: every worker maps the same pages
+ * read-only, so workers add no memory for the corpus and start without
+ * reading it. --unload name removes the segment.
+ *
+ * Bounded memory:
+ * Counting the corpus in a CMap needs every distinct word in memory.
+ * --mem-cap bytes instead counts it by external sorting in about that
+ * much memory: sorted runs of counts are spilled to temporary files and
+ * merged. --count file corpus writes the merged, sorted "word count"
+ * lines to file, and --counts says that the corpus argument is such a
+ * file, which is read straight into the corpus index.
+ * The index itself still holds every distinct word, once, with no
+ * per-word allocation.
+ *
  * Result:
  * For each input word not found in the corpus, print to stdout the top 3
  * "closest" words.
  *
  * Reference:
  * Stanford CS107
- *
- * XXX Use prefix tree data structure for speed. 
  */
 
+#include <assert.h>
 #include <stdlib.h>
 #include <stdio.h>
 #include <ctype.h>
+#include <getopt.h>
 #include <limits.h>
 #include <string.h>
 #include "cvector.h"
 #include "cmap.h"
+#include "corpusindex.h"
+#include "letterhist.h"
+#include "wordcounter.h"
 
 enum {
     MAX_RESULTS = 3,
@@ -42,10 +78,12 @@ enum {
     LEADER_BOARD_CAPACITY_HINT = 5,
     WORDS_CAPACITY_HINT = 50,
     MAX_STRING_LENGTH = 30,
+    BOUNDS_BLOCK = 256, // corpus words bounded at a time
 };
 
+#define DEFAULT_MEM_CAP ((size_t)64 << 20) // for --count
+
 #define min(x1, x2) (x1 < x2 ? x1 : x2)
-#define min3(x1, x2, x3) (x1 < x2 ? min(x1, x3) : min(x2, x3))
 
 /*
  * Define the struct that populates the leader board of suggested corrected
@@ -60,6 +98,25 @@ typedef struct {
     char *s;
 } Correction;
 
+/*
+ * Define the struct for a word being checked.
+ * Keep track of its leader board, of the largest distance and, at that
+ * distance, the smallest frequency that can still make the leader board,
+ * and of whether it is in the corpus at all.
+ * In a batch, sorted, keep track of the length of the prefix it shares with
+ * the word before it.
+ */
+typedef struct {
+    const char *word;
+    int len;
+    int prefix_len;
+    bool is_found;
+    int max_dist;
+    int min_freq;
+    CVector *leader_board;
+    unsigned char hist[LHIST_SIZE];
+} Query;
+
 void s_tolower(char *s) {
     for (int i = 0; s[i] != '\0'; i++) {
         s[i] = tolower(s[i]);
@@ -131,45 +188,142 @@ CMap *build_map(FILE *fp)
     return m;
 }
 
-/* Return true if a word is a key in the map, else return false. */
-bool is_found(const CMap *m, const char *word)
+/*
+ * Count the words in the corpus file in at most about mem_cap bytes, and
+ * write the counts to out in sorted order.
+ * Return false on error.
+ */
+bool count_corpus(FILE *fp, size_t mem_cap, FILE *out)
 {
-    int *p = (int *)cmap_get(m, word);
-    if (p == NULL) {
-        return false;
+    bool ok;
+    char buf[MAX_STRING_LENGTH + 1];
+    WordCounter *wc;
+
+    ok = true;
+    wc = wcount_create(mem_cap);
+    while (ok && read_word(fp, buf)) {
+        s_tolower(buf);
+        ok = wcount_add(wc, buf);
+    }
+    if (ok && ferror(fp)) {
+        perror("read corpus");
+        ok = false;
+    }
+    ok = ok && wcount_finish(wc, out);
+    wcount_dispose(wc);
+    return ok;
+}
+
+/*
+ * Return true if every word in the index is a word read_word could have
+ * read, so that a word count file cannot hand spellcheck longer words.
+ */
+bool is_valid_corpus(const CorpusIndex *ci)
+{
+    int i, j;
+    const char *word;
+
+    for (i = 0; i < cindex_count(ci); i++) {
+        word = cindex_word(ci, i);
+        for (j = 0; word[j] != '\0'; j++) {
+            if (!islower(word[j]) || j == MAX_STRING_LENGTH) {
+                return false;
+            }
+        }
     }
     return true;
 }
 
 /*
- * Return edit distance between two words using dynamic programming.
- * A substitution is penalized by 1 (in some definitions, a substitution
- * is penalized by 2).
- * XXX Do not calculate edit distance once we know it will exceed a
- * given value provided as a parameter.
+ * Return the corpus index of the words in the corpus file, or of the
+ * counts in it if is_counts. If mem_cap is not 0, count the words in
+ * about that much memory.
+ * Return NULL on error.
  */
-int edit_dist(const char *s1, const char *s2)
+CorpusIndex *read_corpus(const char *filename, size_t mem_cap, bool is_counts)
 {
-    int i, j, sub_penalty;
-    int s1_len = strlen(s1);
-    int s2_len = strlen(s2);
-    int dists[s1_len + 1][s2_len + 1];
-
-    for (i = 0; i <= s1_len; i++) {
-        dists[i][0] = i;
-    }
-    for (j = 0; j <= s2_len; j++) {
-        dists[0][j] = j;
-    }
-    for (i = 1; i <= s1_len; i++) {
-        for (j = 1; j <= s2_len; j++) {
-            sub_penalty = (s1[i - 1] == s2[j - 1]) ? 0 : 1;
-            dists[i][j] = min3(dists[i-1][j] + 1,
-                               dists[i][j-1] + 1,
-                               dists[i-1][j-1] + sub_penalty);
+    bool ok;
+    FILE *fp, *counts_fp;
+    CMap *corpus_map;
+    CorpusIndex *ci;
+
+    fp = fopen(filename, "r");
+    if (fp == NULL) {
+        perror(filename);
+        return NULL;
+    }
+    if (is_counts) {
+        ci = cindex_from_counts(fp);
+        fclose(fp);
+        if (ci == NULL || !is_valid_corpus(ci)) {
+            fprintf(stderr, "%s: not a word count file\n", filename);
+            if (ci != NULL) {
+                cindex_dispose(ci);
+            }
+            return NULL;
+        }
+        return ci;
+    }
+    if (mem_cap != 0) {
+        counts_fp = tmpfile();
+        if (counts_fp == NULL) {
+            perror("counts");
+            fclose(fp);
+            return NULL;
+        }
+        ok = count_corpus(fp, mem_cap, counts_fp);
+        fclose(fp);
+        ci = ok ? cindex_from_counts(counts_fp) : NULL;
+        fclose(counts_fp);
+        if (ok && ci == NULL) {
+            perror("counts");
         }
+        return ci;
+    }
+    corpus_map = build_map(fp);
+    fclose(fp);
+    if (corpus_map == NULL) {
+        perror(filename);
+        return NULL;
+    }
+    ci = cindex_from_map(corpus_map);
+    cmap_dispose(corpus_map);
+    return ci;
+}
+
+/*
+ * Write the sorted word counts of the corpus file to counts_name.
+ * Return the exit status.
+ */
+int write_counts(const char *filename, size_t mem_cap, const char *counts_name)
+{
+    bool ok;
+    FILE *fp, *counts_fp;
+
+    fp = fopen(filename, "r");
+    if (fp == NULL) {
+        perror(filename);
+        return 1;
+    }
+    counts_fp = fopen(counts_name, "w");
+    if (counts_fp == NULL) {
+        perror(counts_name);
+        fclose(fp);
+        return 1;
     }
-    return dists[s1_len][s2_len];
+    ok = count_corpus(fp, mem_cap, counts_fp);
+    fclose(fp);
+    if (fclose(counts_fp) != 0 && ok) {
+        perror(counts_name);
+        ok = false;
+    }
+    return ok ? 0 : 1;
+}
+
+/* Return true if a word is in the corpus, else return false. */
+bool is_found(const CorpusIndex *ci, const char *word)
+{
+    return cindex_find(ci, word) >= 0;
 }
 
 /*
@@ -199,10 +353,10 @@ int cmp_correction(const void *p1, const void *p2)
  * replace the last correction with the new correction and sort.
  * Otherwise if the leader board is not full, append a new correction containing
  * word and sort.
- * Precondition: corpus_map is known to contain word.
+ * freq is the frequency of word in the corpus.
  */
-void update_leader_board(const CMap *corpus_map, CVector *leader_board,
-                         const char *word, int d)
+void update_leader_board(CVector *leader_board, const char *word, int freq,
+                         int d)
 {
     int leader_board_count;
     Correction c, *p;
@@ -210,55 +364,239 @@ void update_leader_board(const CMap *corpus_map, CVector *leader_board,
     leader_board_count = cvec_count(leader_board);
     memset(&c, 0, sizeof(c));
     c.dist = d;
-    c.s = strdup(word);
-    c.freq = *(int *)cmap_get(corpus_map, word);
+    c.s = (char *)word; // copied only if it makes the board
+    c.freq = freq;
 
     if (leader_board_count == MAX_RESULTS) { // leader_board is full
         p = cvec_nth(leader_board, MAX_RESULTS - 1);
         if (cmp_correction(&c, p)  < 0)	 { // if better, replace last struct
+            c.s = strdup(word);
             cvec_elem_replace(leader_board, &c, MAX_RESULTS - 1);
             cvec_sort(leader_board, cmp_correction);
         }
-        else { // not appending or replacing
-            free(c.s); // undo strdup
-        }
-        p = cvec_nth(leader_board, MAX_RESULTS - 1);
     }
     else { // leader board is not full
+        c.s = strdup(word);
         cvec_append(leader_board, &c);
         cvec_sort(leader_board, cmp_correction);
     }
 }
 
-/* Print the best alternate spellings for a word to stdout. */
-void spellcheck(const CMap *corpus_map, const char *word,
-                CVector *leader_board, bool print_correct_words)
+/*
+ * Define the struct that counts how the candidates, pairs of a word being
+ * checked and a corpus word, were dealt with.
+ */
+typedef struct {
+    long by_hist; // pruned by the letter histogram bound
+    long by_dp; // pruned part way through the DP
+    long full_dp;
+} PruneStats;
+
+/* Update the bounds a correction must meet to make the leader board. */
+void update_bounds(Query *query)
+{
+    const Correction *worst;
+
+    if (cvec_count(query->leader_board) < MAX_RESULTS) {
+        query->max_dist = INT_MAX;
+        query->min_freq = 0;
+        return;
+    }
+    worst = cvec_nth(query->leader_board, MAX_RESULTS - 1);
+    query->max_dist = worst->dist;
+    query->min_freq = worst->freq;
+}
+
+/*
+ * Return true if a correction at distance d or more, of frequency freq,
+ * might make the leader board. At the worst distance on the board it must
+ * be at least as frequent; if it is as frequent, the spelling decides.
+ */
+static inline bool could_place(const Query *query, int d, int freq)
+{
+    return d < query->max_dist ||
+           (d == query->max_dist && freq >= query->min_freq);
+}
+
+/*
+ * Fill rows *valid + 1 to query->len of dists, the edit distances between
+ * prefixes of the word being checked and of corpus_word, len letters long.
+ * Return the edit distance, or -1 as soon as a row shows that corpus_word
+ * cannot make the leader board: the distance is at least the smallest
+ * entry of any row. Set *valid to the last row filled.
+ * A substitution is penalized by 1 (in some definitions, a substitution
+ * is penalized by 2).
+ */
+int bounded_dist(const Query *query, const char *corpus_word, int len, int freq,
+                 int dists[][MAX_STRING_LENGTH + 1], int *valid)
+{
+    int j, k, d, row_min, sub_penalty, *prev, *row;
+    char ch;
+
+    for (k = *valid + 1; k <= query->len; k++) {
+        prev = dists[k - 1];
+        row = dists[k];
+        ch = query->word[k - 1];
+        row[0] = k;
+        row_min = k;
+        for (j = 1; j <= len; j++) {
+            sub_penalty = (ch == corpus_word[j - 1]) ? 0 : 1;
+            d = prev[j - 1] + sub_penalty;
+            d = min(d, prev[j] + 1);
+            row[j] = min(d, row[j - 1] + 1);
+            row_min = min(row_min, row[j]);
+        }
+        *valid = k;
+        if (!could_place(query, row_min, freq)) {
+            return -1;
+        }
+    }
+    return dists[query->len][len];
+}
+
+/*
+ * Offer a corpus word, of length len and frequency freq, to a word being
+ * checked: prune it by its bound, else run the bounded DP and update the
+ * leader board. Rows up to *valid of dists are already filled for it.
+ */
+static inline void offer(Query *query, const char *corpus_word, int len,
+                         int freq, int bound,
+                         int dists[][MAX_STRING_LENGTH + 1], int *valid,
+                         PruneStats *stats)
 {
     int d;
+
+    if (!could_place(query, bound, freq)) {
+        stats->by_hist++;
+        return;
+    }
+    d = bounded_dist(query, corpus_word, len, freq, dists, valid);
+    if (d < 0) {
+        stats->by_dp++;
+        return;
+    }
+    stats->full_dp++;
+    update_leader_board(query->leader_board, corpus_word, freq, d);
+    update_bounds(query);
+}
+
+/* Return true if corpus_word is one of the query's best-first candidates. */
+static inline bool is_seed(const Query *query, const char *corpus_word, int len)
+{
+    return corpus_word[0] == query->word[0] && len == query->len;
+}
+
+/*
+ * Fill the leader board of a word being checked from its best-first
+ * candidates, the corpus words of the same first letter and length.
+ */
+void seed_leader_board(const CorpusIndex *ci, Query *query, PruneStats *stats)
+{
+    int i, j, n, valid;
+    unsigned char bound;
+    int dists[MAX_STRING_LENGTH + 1][MAX_STRING_LENGTH + 1];
+    const uint32_t *positions;
+
+    n = cindex_candidates(ci, query->word[0], query->len, &positions);
+    for (j = 0; j <= query->len; j++) {
+        dists[0][j] = j; // every candidate has length query->len
+    }
+    for (i = 0; i < n; i++) {
+        lhist_bounds(cindex_hists(ci) + (size_t)positions[i] * LHIST_SIZE, 1,
+                     query->hist, &bound);
+        valid = 0;
+        offer(query, cindex_word(ci, positions[i]), query->len,
+              cindex_freq(ci, positions[i]), bound, dists, &valid, stats);
+    }
+}
+
+/*
+ * Update the leader boards of a batch of words, sorted, with every word in
+ * the corpus, after seeding each from its best-first candidates.
+ * Row k of dists holds the distances between the first k letters of a
+ * word and each prefix of the corpus word. The first valid rows are left
+ * as an earlier word computed them: sorted, the prefix a word shares with
+ * any earlier word is no longer than the one it shares with the word just
+ * before it.
+ */
+void spellcheck_batch(const CorpusIndex *ci, Query **batch, int n_batch,
+                      PruneStats *stats)
+{
+    int i, j, q, len, freq, valid, start, n_block;
+    int dists[MAX_STRING_LENGTH + 1][MAX_STRING_LENGTH + 1];
+    unsigned char *bounds, *word_bounds;
     const char *corpus_word;
+    Query *query;
+
+    for (q = 0; q < n_batch; q++) {
+        seed_leader_board(ci, batch[q], stats);
+    }
+    bounds = malloc((size_t)n_batch * BOUNDS_BLOCK);
+    assert(n_batch == 0 || bounds != NULL);
+    for (start = 0; start < cindex_count(ci); start += BOUNDS_BLOCK) {
+        n_block = min(BOUNDS_BLOCK, cindex_count(ci) - start);
+        for (q = 0; q < n_batch; q++) {
+            lhist_bounds(cindex_hists(ci) + (size_t)start * LHIST_SIZE, n_block,
+                         batch[q]->hist, bounds + (size_t)q * BOUNDS_BLOCK);
+        }
+        for (i = start; i < start + n_block; i++) {
+            corpus_word = cindex_word(ci, i);
+            len = strlen(corpus_word);
+            freq = cindex_freq(ci, i);
+            word_bounds = bounds + i - start;
+            for (j = 0; j <= len; j++) {
+                dists[0][j] = j;
+            }
+            valid = 0;
+            for (q = 0; q < n_batch; q++) {
+                query = batch[q];
+                valid = min(valid, query->prefix_len);
+                if (!is_seed(query, corpus_word, len)) {
+                    offer(query, corpus_word, len, freq,
+                          word_bounds[(size_t)q * BOUNDS_BLOCK], dists, &valid,
+                          stats);
+                }
+            }
+        }
+    }
+    free(bounds);
+}
+
+/* Print the best alternate spellings for a word to stdout. */
+void print_corrections(const Query *query, bool print_correct_words)
+{
     Correction *correctionp;
 
-    if (is_found(corpus_map, word)) {
+    if (query->is_found) {
         if (print_correct_words) {
-            printf("\'%s\' spelled correctly.\n", word);
+            printf("\'%s\' spelled correctly.\n", query->word);
         }
         return;
     }
-    for (corpus_word = cmap_first(corpus_map); corpus_word !=NULL;
-         corpus_word = cmap_next(corpus_map, corpus_word)) {
-
-        d = edit_dist(corpus_word, word);
-        update_leader_board(corpus_map, leader_board, corpus_word, d);
-    }
-    printf("%s:", word);
-    for (correctionp = cvec_first(leader_board); correctionp != NULL;
-         correctionp = cvec_next(leader_board, correctionp)) {
+    printf("%s:", query->word);
+    for (correctionp = cvec_first(query->leader_board); correctionp != NULL;
+         correctionp = cvec_next(query->leader_board, correctionp)) {
 
         printf(" %s",correctionp->s);
     }
     printf("\n");
 }
 
+int cmp_query_ptr(const void *p1, const void *p2)
+{
+    return strcmp((*(const Query **)p1)->word, (*(const Query **)p2)->word);
+}
+
+/* Return the length of the common prefix of two words. */
+int prefix_len(const char *s1, const char *s2)
+{
+    int i;
+
+    for (i = 0; s1[i] != '\0' && s1[i] == s2[i]; i++)
+        ;
+    return i;
+}
+
 /* Cleanup function for the leader board vector. */
 void cleanup_leader_board(void *p)
 {
@@ -267,7 +605,7 @@ void cleanup_leader_board(void *p)
 }
 
 /* Find all unique misspellings in the document. */
-void collect_misspellings(const CMap *corpus_map, FILE *fp, CMap *misspellings_map)
+void collect_misspellings(FILE *fp, CMap *misspellings_map)
 {
     int default_key;
     char buf[MAX_STRING_LENGTH + 1];
@@ -280,63 +618,225 @@ void collect_misspellings(const CMap *corpus_map, FILE *fp, CMap *misspellings_m
     }
 }
 
-int main(int argc, char *argv[])
+/*
+ * Check a document, or a single word if there is no such file, against
+ * the corpus. If print_stats, print how the candidates were pruned.
+ * Return the exit status.
+ */
+int check(const CorpusIndex *ci, char *what_to_check, bool print_stats)
 {
     bool print_correct_words;
-    int default_key;
+    int i, default_key, n_queries, n_batch;
     const char *word;
     FILE *fp;
-    CMap *corpus_map;
     CMap *misspellings_map;
+    Query *queries, *query, **batch;
+    PruneStats stats;
 
-    if (argc != 3) {
-        fprintf(stderr, "%s: you must specify the corpus and what-to-check. "
-                        "The what-to-check argument can be a single word or "
-                        "document.\n", argv[0]);
-        exit(1);
-    }
-    fp = fopen(argv[1], "r");
-    if (fp == NULL) {
-        perror(argv[1]);
-        exit(1);
-    }
-    corpus_map = build_map(fp);
-    fclose(fp);
-    if (corpus_map == NULL) {
-        perror(argv[1]);
-        exit(1);
-    }
     misspellings_map = cmap_create(sizeof(int), WORDS_CAPACITY_HINT, NULL);
 
-    fp = fopen(argv[2], "r");
+    fp = fopen(what_to_check, "r");
     if (fp != NULL) {
         print_correct_words = false;
-        collect_misspellings(corpus_map, fp, misspellings_map);
+        collect_misspellings(fp, misspellings_map);
         fclose(fp);
     }
     else {
-        if (strlen(argv[2]) > MAX_STRING_LENGTH) {
+        if (strlen(what_to_check) > MAX_STRING_LENGTH) {
             fprintf(stderr, "word longer than limit of %d \n", MAX_STRING_LENGTH);
             cmap_dispose(misspellings_map);
-            cmap_dispose(corpus_map);
-            exit(1);
+            return 1;
         }
         print_correct_words = true;
         default_key = 1; // map value here doesn't matter
-        s_tolower(argv[2]);
-        cmap_put(misspellings_map, argv[2], &default_key);
+        s_tolower(what_to_check);
+        cmap_put(misspellings_map, what_to_check, &default_key);
     }
 
+    // Queries are printed in map order, and checked in a sorted batch
+    n_queries = cmap_count(misspellings_map);
+    queries = malloc(n_queries * sizeof(Query));
+    batch = malloc(n_queries * sizeof(Query *));
+    assert(n_queries == 0 || (queries != NULL && batch != NULL));
+    n_queries = 0;
+    n_batch = 0;
     for(word = cmap_first(misspellings_map); word != NULL;
         word = cmap_next(misspellings_map, word)) {
 
-        CVector *leader_board = cvec_create(sizeof(Correction),
-                                            LEADER_BOARD_CAPACITY_HINT,
-                                            cleanup_leader_board);
-        spellcheck(corpus_map, word, leader_board, print_correct_words);
-        cvec_dispose(leader_board);
+        query = &queries[n_queries++];
+        query->word = word;
+        query->len = strlen(word);
+        query->is_found = is_found(ci, word);
+        lhist_count(word, query->hist);
+        query->leader_board = cvec_create(sizeof(Correction),
+                                          LEADER_BOARD_CAPACITY_HINT,
+                                          cleanup_leader_board);
+        update_bounds(query);
+        if (!query->is_found) {
+            batch[n_batch++] = query;
+        }
+    }
+    qsort(batch, n_batch, sizeof(Query *), cmp_query_ptr);
+    for (i = 0; i < n_batch; i++) {
+        batch[i]->prefix_len = i == 0 ? 0 : prefix_len(batch[i - 1]->word,
+                                                        batch[i]->word);
+    }
+    memset(&stats, 0, sizeof(stats));
+    spellcheck_batch(ci, batch, n_batch, &stats);
+    if (print_stats) {
+        fprintf(stderr, "%ld candidates: %ld pruned by letter counts, "
+                        "%ld pruned in the DP, %ld run through the DP\n",
+                stats.by_hist + stats.by_dp + stats.full_dp, stats.by_hist,
+                stats.by_dp, stats.full_dp);
+    }
+
+    for (i = 0; i < n_queries; i++) {
+        print_corrections(&queries[i], print_correct_words);
+        cvec_dispose(queries[i].leader_board);
     }
+    free(batch);
+    free(queries);
     cmap_dispose(misspellings_map);
-    cmap_dispose(corpus_map);
     return 0;
-}
\ No newline at end of file
+}
+
+static const struct option long_options[] = {
+    {"load", required_argument, NULL, 'l'},
+    {"attach", required_argument, NULL, 'a'},
+    {"unload", required_argument, NULL, 'u'},
+    {"mem-cap", required_argument, NULL, 'm'},
+    {"count", required_argument, NULL, 'c'},
+    {"counts", no_argument, NULL, 'C'},
+    {"stats", no_argument, NULL, 's'},
+    {NULL, 0, NULL, 0},
+};
+
+void usage_options(const char *prog)
+{
+    fprintf(stderr, "usage: %s [--mem-cap bytes] [--counts] [--stats] corpus what-to-check\n"
+                    "       %s [--mem-cap bytes] [--counts] --load name corpus\n"
+                    "       %s [--mem-cap bytes] --count file corpus\n"
+                    "       %s [--stats] --attach name what-to-check\n"
+                    "       %s --unload name\n", prog, prog, prog, prog, prog);
+    exit(1);
+}
+
+/* Parse a byte count with an optional k, m or g suffix. Return 0 if bad. */
+size_t parse_size(const char *s)
+{
+    char *end;
+    unsigned long long n;
+
+    n = strtoull(s, &end, 10);
+    switch (tolower(*end)) {
+    case 'g':
+        n <<= 10;
+        // fall through
+    case 'm':
+        n <<= 10;
+        // fall through
+    case 'k':
+        n <<= 10;
+        end++;
+        break;
+    }
+    if (end == s || *end != '\0') {
+        return 0;
+    }
+    return n;
+}
+
+int main(int argc, char *argv[])
+{
+    int opt, n_args, n_options, status;
+    bool is_counts = false, print_stats = false;
+    size_t mem_cap = 0;
+    const char *load_name = NULL, *attach_name = NULL, *unload_name = NULL;
+    const char *counts_name = NULL;
+    CorpusIndex *ci;
+    const CorpusIndex *shared_ci;
+
+    n_options = 0;
+    while ((opt = getopt_long(argc, argv, "", long_options, NULL)) != -1) {
+        n_options++;
+        switch (opt) {
+        case 'l':
+            load_name = optarg;
+            break;
+        case 'a':
+            attach_name = optarg;
+            break;
+        case 'u':
+            unload_name = optarg;
+            break;
+        case 'm':
+            mem_cap = parse_size(optarg);
+            if (mem_cap < WCOUNT_MIN_MEMORY) {
+                fprintf(stderr, "%s: --mem-cap must be at least %d bytes\n",
+                        argv[0], WCOUNT_MIN_MEMORY);
+                exit(1);
+            }
+            break;
+        case 'c':
+            counts_name = optarg;
+            break;
+        case 'C':
+            is_counts = true;
+            break;
+        case 's':
+            print_stats = true;
+            break;
+        default:
+            exit(1);
+        }
+    }
+    n_args = argc - optind;
+    if (unload_name != NULL) {
+        if (n_options != 1 || n_args != 0) {
+            usage_options(argv[0]);
+        }
+        return cindex_unlink(unload_name) ? 0 : 1;
+    }
+    if (attach_name != NULL) {
+        if (n_options != 1 + print_stats || n_args != 1) {
+            usage_options(argv[0]);
+        }
+        shared_ci = cindex_attach(attach_name);
+        if (shared_ci == NULL) {
+            exit(1);
+        }
+        status = check(shared_ci, argv[optind], print_stats);
+        cindex_detach(shared_ci);
+        return status;
+    }
+    if (counts_name != NULL) {
+        if (load_name != NULL || is_counts || print_stats || n_args != 1) {
+            usage_options(argv[0]);
+        }
+        return write_counts(argv[optind], mem_cap != 0 ? mem_cap : DEFAULT_MEM_CAP,
+                            counts_name);
+    }
+    if (n_args != (load_name != NULL ? 1 : 2) ||
+        (load_name != NULL && print_stats)) {
+        if (n_options != 0) {
+            usage_options(argv[0]);
+        }
+        fprintf(stderr, "%s: you must specify the corpus and what-to-check. "
+                        "The what-to-check argument can be a single word or "
+                        "document.\n", argv[0]);
+        exit(1);
+    }
+
+    ci = read_corpus(argv[optind], mem_cap, is_counts);
+    if (ci == NULL) {
+        exit(1);
+    }
+    if (load_name != NULL) {
+        status = cindex_publish(ci, load_name) ? 0 : 1;
+    }
+    else {
+        status = check(ci, argv[optind + 1], print_stats);
+    }
+    cindex_dispose(ci);
+    return status;
+}
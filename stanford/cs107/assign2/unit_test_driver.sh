@@ -54,6 +54,67 @@ if [ $? -ne 0 ]; then
     ERROR_FLAG=1
 fi
 
+# The same document, reporting how the candidates were pruned
+./spellcheck --stats tests/corpus2.txt tests/doc1.txt > tests/func_doc1.out 2> tests/stats_doc1.out
+diff $TEST_DIR/func_doc1.ref $TEST_DIR/func_doc1.out && diff $TEST_DIR/stats_doc1.ref $TEST_DIR/stats_doc1.out
+if [ $? -ne 0 ]; then
+    printf "tests/doc1.txt did not pass with --stats using corpus $TEST_DIR/corpus2.txt.\n"
+    ERROR_FLAG=1
+fi
+
+# The same document against a corpus index in shared memory
+SHM_NAME=/spellcheck_test_$$
+./spellcheck --load $SHM_NAME $TEST_DIR/corpus2.txt
+./spellcheck --attach $SHM_NAME $TEST_DIR/doc1.txt > $TEST_DIR/func_doc1.out 2>&1
+diff $TEST_DIR/func_doc1.ref $TEST_DIR/func_doc1.out
+if [ $? -ne 0 ]; then
+    printf "tests/doc1.txt did not pass attached to $SHM_NAME.\n"
+    ERROR_FLAG=1
+fi
+./spellcheck --unload $SHM_NAME
+
+# The same document with the corpus counted in 16K, spilling runs
+./spellcheck --mem-cap 16k $TEST_DIR/corpus2.txt $TEST_DIR/doc1.txt > $TEST_DIR/func_doc1.out 2>&1
+diff $TEST_DIR/func_doc1.ref $TEST_DIR/func_doc1.out
+if [ $? -ne 0 ]; then
+    printf "tests/doc1.txt did not pass counting $TEST_DIR/corpus2.txt in 16K.\n"
+    ERROR_FLAG=1
+fi
+
+# The same document with the corpus repeated 8 times, counted in 64K with
+# few files open: more runs spill than are merged at once, or could be
+# held open at once
+BIG_CORPUS=$TEST_DIR/corpus2x8.txt
+for i in 1 2 3 4 5 6 7 8;
+do
+    cat $TEST_DIR/corpus2.txt
+done > $BIG_CORPUS
+(ulimit -n 24; ./spellcheck --mem-cap 64k $BIG_CORPUS $TEST_DIR/doc1.txt) > $TEST_DIR/func_doc1.out 2>&1
+diff $TEST_DIR/func_doc1.ref $TEST_DIR/func_doc1.out
+if [ $? -ne 0 ]; then
+    printf "tests/doc1.txt did not pass counting $BIG_CORPUS in 64K with 24 files.\n"
+    ERROR_FLAG=1
+fi
+rm -f $BIG_CORPUS
+
+# The same document against a word count file
+COUNTS=$TEST_DIR/corpus2.counts
+./spellcheck --mem-cap 16k --count $COUNTS $TEST_DIR/corpus2.txt
+./spellcheck --counts $COUNTS $TEST_DIR/doc1.txt > $TEST_DIR/func_doc1.out 2>&1
+diff $TEST_DIR/func_doc1.ref $TEST_DIR/func_doc1.out
+if [ $? -ne 0 ]; then
+    printf "tests/doc1.txt did not pass using counts $COUNTS.\n"
+    ERROR_FLAG=1
+fi
+rm -f $COUNTS
+
+# Concurrent appends to a CAppendVector
+./cappendtest > /dev/null
+if [ $? -ne 0 ]; then
+    printf "cappendtest did not pass.\n"
+    ERROR_FLAG=1
+fi
+
 if [ $ERROR_FLAG -ne 0 ]; then
     printf "Not all tests passed.\n"
 else
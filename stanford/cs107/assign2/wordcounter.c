@@ -0,0 +1,408 @@
+/*
+ * Implementation of the WordCounter API.
+ * All of the memory cap is one buffer. Words are copied in from the
+ * front, and a pointer to each is pushed on an array growing down from the
+ * back; the buffer is full when the two meet. A full buffer is sorted by
+ * sorting the pointer array, and written out with each run of equal words
+ * as one count.
+ *
+ * A spilled run is an unnamed temporary file, held by its descriptor.
+ * Merging reuses the buffer, which is free right after a spill, as the
+ * stdio buffers of the runs being read, so the fan-in is as large as the
+ * memory cap allows, short of the limit on open files. Runs are merged
+ * as they are spilled, like carries in a counter: a spill is level 0, and
+ * whenever the newest fan-in runs share a level they become one run of the
+ * next level. Each word is then rewritten once per level, and only a few
+ * runs per level stay open. Should the runs still reach the open-file
+ * budget, the newest fan-in runs are merged regardless.
+ *
+ * Author:
+ * Elizabeth Howe
+ */
+
+#include "wordcounter.h"
+#include <assert.h>
+#include <stdlib.h>
+#include <limits.h>
+#include <string.h>
+#include <unistd.h>
+
+enum {
+    MERGE_BUFFER_SIZE = 4096, // read buffer per run being merged
+    OPEN_FILES_HEADROOM = 16, // descriptors left to the rest of the process
+};
+
+/* A spilled or merged run */
+typedef struct {
+    int fd;
+    int level; // 0 if spilled, one more than its inputs if merged
+} Run;
+
+/* Define the WordCounter internals */
+typedef struct WordCounter_internals {
+    char *buf;
+    size_t buf_size; // a multiple of sizeof(char *)
+    size_t text_size; // bytes of words at the front of buf
+    int n_words; // pointers at the back of buf
+    Run *runs; // oldest first, so their levels never increase
+    int n_runs;
+    int runs_capacity;
+    int fan_in; // runs merged at once
+    int run_cap; // runs that may be open at once
+} WordCounter;
+
+/* The next line of a run being merged */
+typedef struct {
+    FILE *fp;
+    char *word;
+    size_t capacity;
+    long count;
+} Cursor;
+
+WordCounter *wcount_create(size_t mem_cap)
+{
+    WordCounter *wc;
+    long open_max = sysconf(_SC_OPEN_MAX);
+    size_t fan_in;
+
+    assert(mem_cap >= WCOUNT_MIN_MEMORY);
+    wc = calloc(1, sizeof(WordCounter));
+    assert(wc != NULL);
+    wc->buf_size = mem_cap - mem_cap % sizeof(char *);
+    wc->buf = malloc(wc->buf_size);
+    assert(wc->buf != NULL);
+    // A merge holds its inputs open, plus two descriptors of its output
+    wc->run_cap = open_max < 0 || open_max > INT_MAX ? INT_MAX :
+                  (int)open_max - OPEN_FILES_HEADROOM;
+    if (wc->run_cap < 2) {
+        wc->run_cap = 2;
+    }
+    fan_in = wc->buf_size / MERGE_BUFFER_SIZE;
+    wc->fan_in = fan_in < (size_t)wc->run_cap ? (int)fan_in : wc->run_cap;
+    return wc;
+}
+
+void wcount_dispose(WordCounter *wc)
+{
+    int i;
+
+    for (i = 0; i < wc->n_runs; i++) {
+        close(wc->runs[i].fd); // the file has no name, so this removes it
+    }
+    free(wc->runs);
+    free(wc->buf);
+    free(wc);
+}
+
+static char **get_words(const WordCounter *wc)
+{
+    return (char **)(wc->buf + wc->buf_size) - wc->n_words;
+}
+
+static int cmp_word_ptr(const void *p1, const void *p2)
+{
+    return strcmp(*(char **)p1, *(char **)p2);
+}
+
+/* Return a descriptor of a new empty temporary file, or -1 on error */
+static int temp_run(void)
+{
+    int fd;
+    FILE *fp;
+
+    fp = tmpfile();
+    if (fp == NULL) {
+        return -1;
+    }
+    fd = dup(fileno(fp));
+    fclose(fp);
+    return fd;
+}
+
+/* Return a stream writing to the run fd, leaving fd open */
+static FILE *write_run(int fd)
+{
+    int dup_fd;
+    FILE *fp;
+
+    dup_fd = dup(fd);
+    if (dup_fd < 0) {
+        return NULL;
+    }
+    fp = fdopen(dup_fd, "w");
+    if (fp == NULL) {
+        close(dup_fd);
+    }
+    return fp;
+}
+
+static void push_run(WordCounter *wc, int fd, int level)
+{
+    if (wc->n_runs == wc->runs_capacity) {
+        wc->runs_capacity = wc->runs_capacity == 0 ? 8 : 2 * wc->runs_capacity;
+        wc->runs = realloc(wc->runs, wc->runs_capacity * sizeof(Run));
+        assert(wc->runs != NULL);
+    }
+    wc->runs[wc->n_runs].fd = fd;
+    wc->runs[wc->n_runs++].level = level;
+}
+
+/* Sort the buffered words and write them, combined, to out */
+static void write_buffer(WordCounter *wc, FILE *out)
+{
+    int i, j;
+    char **words = get_words(wc);
+
+    qsort(words, wc->n_words, sizeof(char *), cmp_word_ptr);
+    for (i = 0; i < wc->n_words; i = j) {
+        for (j = i + 1; j < wc->n_words && strcmp(words[i], words[j]) == 0; j++)
+            ;
+        fprintf(out, "%s %d\n", words[i], j - i);
+    }
+    wc->text_size = 0;
+    wc->n_words = 0;
+}
+
+/* Spill the buffered words to a new run */
+static bool spill(WordCounter *wc)
+{
+    int fd;
+    FILE *fp;
+
+    fd = temp_run();
+    fp = fd < 0 ? NULL : write_run(fd);
+    if (fp == NULL) {
+        perror("spill run");
+        if (fd >= 0) {
+            close(fd);
+        }
+        return false;
+    }
+    write_buffer(wc, fp);
+    if (ferror(fp) | fclose(fp)) {
+        perror("spill run");
+        close(fd);
+        return false;
+    }
+    push_run(wc, fd, 0);
+    return true;
+}
+
+/* Read the next "word count" line of a run. Return false at its end. */
+static bool cursor_next(Cursor *c)
+{
+    char *space;
+
+    if (getline(&c->word, &c->capacity, c->fp) <= 0) {
+        return false;
+    }
+    space = strrchr(c->word, ' ');
+    assert(space != NULL);
+    *space = '\0';
+    c->count = strtol(space + 1, NULL, 10);
+    return true;
+}
+
+static bool cursor_less(const Cursor *cursors, int a, int b)
+{
+    return strcmp(cursors[a].word, cursors[b].word) < 0;
+}
+
+/* Restore the heap order of heap[0..n) below position i */
+static void sift_down(const Cursor *cursors, int *heap, int n, int i)
+{
+    int child, tmp;
+
+    while ((child = 2 * i + 1) < n) {
+        if (child + 1 < n && cursor_less(cursors, heap[child + 1], heap[child])) {
+            child++;
+        }
+        if (!cursor_less(cursors, heap[child], heap[i])) {
+            break;
+        }
+        tmp = heap[i];
+        heap[i] = heap[child];
+        heap[child] = tmp;
+        i = child;
+    }
+}
+
+/*
+ * Merge the k runs into out, adding up the counts of equal words, and
+ * close the runs.
+ */
+static bool merge_runs(WordCounter *wc, const Run *runs, int k, FILE *out)
+{
+    int i, n_heap, top;
+    bool ok, have_word;
+    long count;
+    char *word;
+    size_t word_capacity;
+    Cursor *cursors, *c;
+    int *heap;
+
+    assert((size_t)k * MERGE_BUFFER_SIZE <= wc->buf_size);
+    cursors = calloc(k, sizeof(Cursor));
+    heap = malloc(k * sizeof(int));
+    assert(cursors != NULL && heap != NULL);
+    ok = true;
+    n_heap = 0;
+    for (i = 0; i < k; i++) {
+        cursors[i].fp = lseek(runs[i].fd, 0, SEEK_SET) == 0 ?
+                        fdopen(runs[i].fd, "r") : NULL;
+        if (cursors[i].fp == NULL) {
+            perror("merge run");
+            close(runs[i].fd);
+            ok = false;
+            continue;
+        }
+        setvbuf(cursors[i].fp, wc->buf + i * MERGE_BUFFER_SIZE, _IOFBF,
+                MERGE_BUFFER_SIZE);
+        if (cursor_next(&cursors[i])) {
+            heap[n_heap++] = i;
+        }
+    }
+    for (i = n_heap / 2 - 1; i >= 0; i--) {
+        sift_down(cursors, heap, n_heap, i);
+    }
+
+    word = NULL;
+    word_capacity = 0;
+    have_word = false;
+    count = 0;
+    while (ok && n_heap > 0) {
+        top = heap[0];
+        c = &cursors[top];
+        if (have_word && strcmp(word, c->word) == 0) {
+            count += c->count;
+        }
+        else {
+            if (have_word) {
+                fprintf(out, "%s %ld\n", word, count);
+            }
+            if (strlen(c->word) + 1 > word_capacity) {
+                word_capacity = strlen(c->word) + 1;
+                word = realloc(word, word_capacity);
+                assert(word != NULL);
+            }
+            strcpy(word, c->word);
+            count = c->count;
+            have_word = true;
+        }
+        if (!cursor_next(c)) {
+            heap[0] = heap[--n_heap];
+        }
+        sift_down(cursors, heap, n_heap, 0);
+    }
+    if (ok && have_word) {
+        fprintf(out, "%s %ld\n", word, count);
+    }
+    for (i = 0; i < k; i++) {
+        if (cursors[i].fp != NULL) {
+            if (ferror(cursors[i].fp)) {
+                perror("merge run");
+                ok = false;
+            }
+            fclose(cursors[i].fp); // closes runs[i].fd
+        }
+        free(cursors[i].word);
+    }
+    free(word);
+    free(heap);
+    free(cursors);
+    return ok;
+}
+
+/*
+ * Merge the newest k runs into one run. It is of the next level if they
+ * all share one, and else of the level of the oldest of them.
+ */
+static bool merge_newest(WordCounter *wc, int k)
+{
+    int fd, level;
+    bool ok;
+    FILE *fp;
+
+    fd = temp_run();
+    fp = fd < 0 ? NULL : write_run(fd);
+    if (fp == NULL) {
+        perror("merge run");
+        if (fd >= 0) {
+            close(fd);
+        }
+        return false;
+    }
+    wc->n_runs -= k;
+    level = wc->runs[wc->n_runs].level;
+    if (wc->runs[wc->n_runs + k - 1].level == level) {
+        level++;
+    }
+    ok = merge_runs(wc, wc->runs + wc->n_runs, k, fp);
+    if (ferror(fp) | fclose(fp)) {
+        perror("merge run");
+        ok = false;
+    }
+    if (!ok) {
+        close(fd);
+        return false;
+    }
+    push_run(wc, fd, level);
+    return true;
+}
+
+/*
+ * Merge the newest fan-in runs while they share a level, or while there
+ * are as many runs open as allowed. The buffer must be empty.
+ */
+static bool collapse_runs(WordCounter *wc)
+{
+    int k = wc->fan_in;
+
+    assert(wc->n_words == 0);
+    while (wc->n_runs >= k &&
+           (wc->runs[wc->n_runs - k].level == wc->runs[wc->n_runs - 1].level ||
+            wc->n_runs >= wc->run_cap)) {
+        if (!merge_newest(wc, k)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool wcount_add(WordCounter *wc, const char *word)
+{
+    size_t len = strlen(word) + 1;
+
+    assert(len + sizeof(char *) <= wc->buf_size);
+    if (wc->text_size + len + (wc->n_words + 1) * sizeof(char *) > wc->buf_size) {
+        if (!spill(wc) || !collapse_runs(wc)) {
+            return false;
+        }
+    }
+    memcpy(wc->buf + wc->text_size, word, len);
+    wc->n_words++;
+    get_words(wc)[0] = wc->buf + wc->text_size;
+    wc->text_size += len;
+    return true;
+}
+
+bool wcount_finish(WordCounter *wc, FILE *out)
+{
+    bool ok;
+
+    if (wc->n_runs == 0) {
+        write_buffer(wc, out);
+        return !ferror(out);
+    }
+    if (wc->n_words > 0 && !spill(wc)) {
+        return false;
+    }
+    while (wc->n_runs > wc->fan_in) {
+        if (!merge_newest(wc, wc->fan_in)) {
+            return false;
+        }
+    }
+    ok = merge_runs(wc, wc->runs, wc->n_runs, out);
+    wc->n_runs = 0;
+    return ok && !ferror(out);
+}
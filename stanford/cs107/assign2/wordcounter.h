@@ -0,0 +1,61 @@
+/*
+ * WordCounter API.
+ *
+ * Motivation:
+ * Counting words in a CMap needs every distinct word in memory at once,
+ * so counting fails on a corpus whose vocabulary does not fit.
+ * A WordCounter counts words exactly in a fixed amount of memory. Words
+ * are collected in a buffer; when it is full they are sorted, equal words
+ * are combined into one count, and the counts are spilled to a temporary
+ * file as a sorted run. Runs are merged k at a time as they pile up, so
+ * that only a few are open at once, and at the end into one sorted file of
+ * "word count" lines.
+ *
+ * Author:
+ * Elizabeth Howe
+ */
+
+#ifndef _wordcounter_h
+#define _wordcounter_h
+
+#include <stdbool.h>
+#include <stdio.h>
+
+/* Define the WordCounter type */
+typedef struct WordCounter_internals WordCounter;
+
+/* The smallest memory cap a WordCounter accepts */
+#define WCOUNT_MIN_MEMORY 16384
+
+/*
+ * Return a new dynamically-allocated empty WordCounter that uses at most
+ * about mem_cap bytes, which must be at least WCOUNT_MIN_MEMORY, beyond
+ * the stdio buffer of the one file it writes at a time.
+ * When done with it, client must call wcount_dispose.
+ * O(1) time.
+ */
+WordCounter *wcount_create(size_t mem_cap);
+
+/*
+ * Deallocate the WordCounter and remove its temporary files.
+ * O(number of runs) time.
+ */
+void wcount_dispose(WordCounter *wc);
+
+/*
+ * Count one occurrence of word.
+ * Return false, after printing why, if a run could not be spilled.
+ * O(1) time (amortized), plus sorting and spilling a full buffer, and
+ * merging the runs spilled so far.
+ */
+bool wcount_add(WordCounter *wc, const char *word);
+
+/*
+ * Write every word counted, in strcmp order, one "word count" line each,
+ * to out.
+ * Return false, after printing why, on an I/O error.
+ * O(N log R) time for N counts in R runs.
+ */
+bool wcount_finish(WordCounter *wc, FILE *out);
+
+#endif
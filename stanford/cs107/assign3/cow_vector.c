@@ -0,0 +1,210 @@
+/*
+* Implementation of the copy-on-write vector in C.
+* Both the chunks and the table of chunk pointers are reference counted.
+* A snapshot shares the table. Before the first write, a vector that
+* shares its table makes a private copy of it, which takes a reference on
+* every chunk; a chunk that is still shared is then copied before it is
+* written. A chunk or table with a reference count of 1 belongs to the
+* writer alone and is written in place.
+*
+* Releasing a reference is an acquire-release operation, so a reader's
+* last reads of a chunk happen before a writer that sees the count drop
+* to 1 writes to it.
+*
+* Author:
+* Elizabeth Howe
+*/
+
+#include "cow_vector.h"
+#include <assert.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+
+static const int default_chunk_length = 256;
+static const int default_table_capacity = 8;
+
+static int ref_count(const int *refcount)
+{
+    return __atomic_load_n(refcount, __ATOMIC_ACQUIRE);
+}
+
+static void ref_acquire(int *refcount)
+{
+    __atomic_add_fetch(refcount, 1, __ATOMIC_RELAXED);
+}
+
+/* Return true if this was the last reference */
+static bool ref_release(int *refcount)
+{
+    return __atomic_sub_fetch(refcount, 1, __ATOMIC_ACQ_REL) == 0;
+}
+
+static size_t chunk_bytes(const cow_vector *v)
+{
+    return sizeof(cow_chunk) + (size_t)v->elem_size * v->chunk_length;
+}
+
+static cow_table *table_new(int capacity)
+{
+    cow_table *table = malloc(sizeof(cow_table));
+
+    assert(table != NULL);
+    table->refcount = 1;
+    table->n_chunks = 0;
+    table->capacity = capacity;
+    table->chunks = malloc(capacity * sizeof(cow_chunk *));
+    assert(table->chunks != NULL);
+    return table;
+}
+
+static void table_release(cow_table *table)
+{
+    int i;
+
+    if (!ref_release(&table->refcount)) {
+        return;
+    }
+    for (i = 0; i < table->n_chunks; i++) {
+        if (ref_release(&table->chunks[i]->refcount)) {
+            free(table->chunks[i]);
+        }
+    }
+    free(table->chunks);
+    free(table);
+}
+
+/* O(1) */
+void cow_vector_new(cow_vector *v, int elem_size, int chunk_length)
+{
+    assert(elem_size > 0);
+    assert(chunk_length >= 0);
+
+    if (chunk_length == 0) {
+        chunk_length = default_chunk_length;
+    }
+    v->elem_size = elem_size;
+    v->chunk_length = 1;
+    v->chunk_shift = 0;
+    while (v->chunk_length < chunk_length) {
+        v->chunk_length <<= 1;
+        v->chunk_shift++;
+    }
+    v->length = 0;
+    v->table = table_new(default_table_capacity);
+}
+
+/* O(number of chunks) */
+void cow_vector_dispose(cow_vector *v)
+{
+    table_release(v->table);
+}
+
+/* O(1) */
+int cow_vector_length(const cow_vector *v)
+{
+    return v->length;
+}
+
+/* O(1) */
+const void *cow_vector_nth(const cow_vector *v, int position)
+{
+    assert(position >= 0 && position < v->length);
+    return v->table->chunks[position >> v->chunk_shift]->elems +
+           (size_t)(position & (v->chunk_length - 1)) * v->elem_size;
+}
+
+/*
+* O(number of chunks) if the table is shared, else O(1)
+* Make the vector's table private, with room for one more chunk.
+*/
+static void own_table(cow_vector *v)
+{
+    cow_table *table;
+    int i, capacity;
+
+    if (ref_count(&v->table->refcount) == 1) {
+        if (v->table->n_chunks == v->table->capacity) {
+            v->table->capacity *= 2;
+            v->table->chunks = realloc(v->table->chunks,
+                                       v->table->capacity * sizeof(cow_chunk *));
+            assert(v->table->chunks != NULL);
+        }
+        return;
+    }
+    capacity = v->table->capacity;
+    if (v->table->n_chunks == capacity) {
+        capacity *= 2;
+    }
+    table = table_new(capacity);
+    // Only the chunks up to the vector's length are its own
+    table->n_chunks = (v->length + v->chunk_length - 1) >> v->chunk_shift;
+    for (i = 0; i < table->n_chunks; i++) {
+        table->chunks[i] = v->table->chunks[i];
+        ref_acquire(&table->chunks[i]->refcount);
+    }
+    table_release(v->table);
+    v->table = table;
+}
+
+/*
+* O(chunk length) if the chunk is shared, else O(1)
+* Make chunk i of the vector's private table private too.
+*/
+static cow_chunk *own_chunk(cow_vector *v, int i)
+{
+    cow_chunk *chunk = v->table->chunks[i];
+    cow_chunk *copy;
+
+    if (ref_count(&chunk->refcount) == 1) {
+        return chunk;
+    }
+    copy = malloc(chunk_bytes(v));
+    assert(copy != NULL);
+    copy->refcount = 1;
+    memcpy(copy->elems, chunk->elems, (size_t)v->elem_size * v->chunk_length);
+    if (ref_release(&chunk->refcount)) {
+        free(chunk); // the other owners let go meanwhile
+    }
+    v->table->chunks[i] = copy;
+    return copy;
+}
+
+/* O(1), plus the cost of copying a shared table or chunk */
+void cow_vector_replace(cow_vector *v, const void *elem_addr, int position)
+{
+    cow_chunk *chunk;
+
+    assert(position >= 0 && position < v->length);
+
+    own_table(v);
+    chunk = own_chunk(v, position >> v->chunk_shift);
+    memcpy(chunk->elems + (size_t)(position & (v->chunk_length - 1)) * v->elem_size,
+           elem_addr, v->elem_size);
+}
+
+/* Amortized O(1), plus the cost of copying a shared table or chunk */
+void cow_vector_append(cow_vector *v, const void *elem_addr)
+{
+    cow_chunk *chunk;
+    int i = v->length >> v->chunk_shift;
+
+    own_table(v);
+    if (i == v->table->n_chunks) {
+        chunk = malloc(chunk_bytes(v));
+        assert(chunk != NULL);
+        chunk->refcount = 1;
+        v->table->chunks[v->table->n_chunks++] = chunk;
+    }
+    chunk = own_chunk(v, i);
+    memcpy(chunk->elems + (size_t)(v->length & (v->chunk_length - 1)) * v->elem_size,
+           elem_addr, v->elem_size);
+    v->length++;
+}
+
+/* O(1) */
+void cow_vector_snapshot(const cow_vector *v, cow_vector *snapshot)
+{
+    ref_acquire(&v->table->refcount);
+    *snapshot = *v;
+}
@@ -0,0 +1,95 @@
+/*
+* Copy-on-write vector API.
+*
+* Motivation:
+* A reader that scans a vector while a writer keeps changing it needs a
+* consistent view, which with a plain vector means a full copy. The
+* copy-on-write vector stores its elements in fixed-size chunks shared
+* by reference count, so that a snapshot costs O(1): it shares every
+* chunk with the vector it was taken from. A write to a shared chunk
+* first copies that chunk only, so the memory overhead of a snapshot is
+* proportional to the changes made while it is alive.
+*
+* The elements must be plain old data, since chunks are copied byte for
+* byte and shared between vectors.
+*
+* Author:
+* Elizabeth Howe
+*/
+
+#ifndef _COW_VECTOR_H_
+#define _COW_VECTOR_H_
+
+/* A chunk of elements, shared by the vectors that reference it */
+typedef struct {
+    int refcount;
+    char elems[] __attribute__((aligned(16))); // aligned for any element
+} cow_chunk;
+
+/* The chunk table, itself shared by the vectors that reference it */
+typedef struct {
+    int refcount;
+    int n_chunks;
+    int capacity;
+    cow_chunk **chunks;
+} cow_table;
+
+/* The internal representation of a copy-on-write vector */
+typedef struct {
+    cow_table *table;
+    int length;
+    int elem_size;
+    int chunk_length; // elements per chunk, a power of two
+    int chunk_shift; // log2 of chunk_length
+} cow_vector;
+
+/*
+ * Usage: cow_vector v;
+ *        cow_vector_new(&v, sizeof(struct score), 0);
+ *
+ * Construct an empty copy-on-write vector in the caller's stack.
+ * chunk_length is the number of elements per chunk, rounded up to a
+ * power of two, or 0 to let the implementation choose. Smaller chunks
+ * make writes to shared chunks cheaper and snapshots bigger.
+ */
+void cow_vector_new(cow_vector *v, int elem_size, int chunk_length);
+
+/*
+ * Free up memory consumed by the vector. Chunks still shared with other
+ * vectors live on until those are disposed of too.
+ */
+void cow_vector_dispose(cow_vector *v);
+
+/* Return the number of elements in the vector. */
+int cow_vector_length(const cow_vector *v);
+
+/*
+ * Return a pointer to the element numbered position. The element must
+ * not be written through the pointer, which is valid until the next
+ * write to the vector.
+ */
+const void *cow_vector_nth(const cow_vector *v, int position);
+
+/* Overwrite the element at the specified position with a new value. */
+void cow_vector_replace(cow_vector *v, const void *elem_addr, int position);
+
+/* Append a copy of the element at elem_addr to the end of the vector. */
+void cow_vector_append(cow_vector *v, const void *elem_addr);
+
+/*
+ * Usage: cow_vector snapshot;
+ *        cow_vector_snapshot(&v, &snapshot);
+ *        hand snapshot to a reader, which disposes of it when done
+ *
+ * Construct in snapshot a vector holding the current elements of v, in
+ * O(1). Later writes to either vector are not seen by the other.
+ *
+ * Each vector may be used by one thread at a time, and a snapshot must
+ * not be taken while v is being written. Beyond that, v and its
+ * snapshots can be read, written and disposed of from different threads
+ * without locks: shared chunks are never written, and the reference
+ * counts are updated atomically.
+ */
+void cow_vector_snapshot(const cow_vector *v, cow_vector *snapshot);
+
+#endif
@@ -0,0 +1,132 @@
+/*
+ * File: hashcheck.c
+ * Author: Elizabeth Howe
+ * ----------------------
+ * Summary:
+ * Read a sample of words and report how well each of a few string hash
+ * functions spreads them over the buckets of a hashset.
+ * A hash function flagged as degenerate should not be used in production.
+ *
+ * Args:
+ * 1. A file of whitespace separated words
+ * 2. Optionally, the number of buckets (default 1009)
+ *
+ * Result:
+ * Print one hashset_hash_report per hash function to stdout.
+ * Exit with status 2 if any hash function was flagged.
+ */
+
+#include "hashstats.h"
+#include "hashfun.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+enum {
+    DEFAULT_NUM_BUCKETS = 1009,
+    MAX_WORD_LENGTH = 63,
+};
+
+/* Add up the characters: anagrams collide and long words cluster. */
+static int hash_sum(const void *elem, int num_buckets)
+{
+    const char *s = *(const char **)elem;
+    unsigned long hashcode = 0;
+
+    while (*s != '\0') {
+        hashcode += (unsigned char)*s++;
+    }
+    return hashcode % num_buckets;
+}
+
+/* Linear congruence, from Eric Roberts' _The Art and Science of C_ */
+static int hash_roberts(const void *elem, int num_buckets)
+{
+    const char *s = *(const char **)elem;
+    const unsigned long MULTIPLIER = 2630849305L;
+    unsigned long hashcode = 0;
+
+    while (*s != '\0') {
+        hashcode = hashcode * MULTIPLIER + (unsigned char)*s++;
+    }
+    return hashcode % num_buckets;
+}
+
+static int cmp_string(const void *elem1, const void *elem2)
+{
+    return strcmp(*(const char **)elem1, *(const char **)elem2);
+}
+
+static void free_string(void *elem)
+{
+    free(*(char **)elem);
+}
+
+static const struct {
+    const char *name;
+    hashset_hash_fun hash_fun;
+} hash_funs[] = {
+    {"sum", hash_sum},
+    {"roberts", hash_roberts},
+    {"hash_string", hash_string_fun},
+};
+
+int main(int argc, char *argv[])
+{
+    int i, num_buckets = DEFAULT_NUM_BUCKETS;
+    size_t f;
+    int degenerate = 0;
+    char buf[MAX_WORD_LENGTH + 1];
+    char *word;
+    FILE *fp;
+    vector words;
+    hashset_hash_report report;
+
+    if (argc < 2 || argc > 3) {
+        fprintf(stderr, "usage: %s words-file [num-buckets]\n", argv[0]);
+        exit(1);
+    }
+    if (argc == 3) {
+        num_buckets = atoi(argv[2]);
+        if (num_buckets <= 0) {
+            fprintf(stderr, "num-buckets must be a positive number.\n");
+            exit(1);
+        }
+    }
+    fp = fopen(argv[1], "r");
+    if (fp == NULL) {
+        perror(argv[1]);
+        exit(1);
+    }
+    vector_new(&words, sizeof(char *), free_string, 1024);
+    while (fscanf(fp, "%63s", buf) == 1) {
+        word = strdup(buf);
+        if (word == NULL) {
+            perror("strdup");
+            exit(1);
+        }
+        vector_append(&words, &word);
+    }
+    fclose(fp);
+
+    // Duplicate words would be counted as collisions, keep one of each
+    vector_sort(&words, cmp_string);
+    for (i = vector_length(&words) - 1; i > 0; i--) {
+        if (cmp_string(vector_nth(&words, i), vector_nth(&words, i - 1)) == 0) {
+            vector_elem_delete(&words, i);
+        }
+    }
+
+    for (f = 0; f < sizeof(hash_funs) / sizeof(hash_funs[0]); f++) {
+        printf("%s: ", hash_funs[f].name);
+        // Elements are char *, so bits cannot be flipped safely
+        hashset_analyze(&words, num_buckets, hash_funs[f].hash_fun,
+                        cmp_string, false, &report);
+        hashset_report_print(stdout, &report);
+        if (hashset_report_degenerate(&report)) {
+            degenerate = 1;
+        }
+    }
+    vector_dispose(&words);
+    return degenerate ? 2 : 0;
+}
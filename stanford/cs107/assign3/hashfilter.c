@@ -0,0 +1,343 @@
+/*
+* Implementation of the approximate membership filters.
+*
+* Quotient filter (Bender et al., "Don't Thrash: How to Cache Your Hash
+* on Flash", 2012):
+* The top q bits of a hash code are its quotient, the canonical slot.
+* The next 13 bits are its remainder, the only part that is stored.
+* Remainders sharing a quotient form a sorted run; runs are stored in
+* quotient order and shifted right when their canonical slot is taken.
+* Each slot carries three bits of metadata:
+* occupied - some hash code has this slot as its quotient
+* continuation - this slot continues the run of the slot before it
+* shifted - the remainder in this slot is not in its canonical slot
+*
+* Xor filter (Graf and Lemire, "Xor Filters: Faster and Smaller Than Bloom
+* and Cuckoo Filters", 2020):
+* Each hash code maps to one fingerprint slot in each of three blocks.
+* The fingerprints are chosen so that the xor of a code's three slots is
+* the code's own 8-bit fingerprint. They are found by peeling: repeatedly
+* take a slot used by a single code, which is then free to be solved last.
+*
+* Author:
+* Elizabeth Howe
+*/
+
+#include "hashfilter.h"
+#include "hashfun.h"
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+
+enum {
+    R_BITS = 13,
+    MIN_Q_BITS = 6,
+    OCCUPIED = 1 << 0,
+    CONTINUATION = 1 << 1,
+    SHIFTED = 1 << 2,
+    METADATA = OCCUPIED | CONTINUATION | SHIFTED,
+    MAX_XOR_SEEDS = 64,
+};
+
+/* O(2^q) */
+void quotient_filter_new(quotient_filter *qf, int capacity_hint)
+{
+    assert(capacity_hint >= 0);
+
+    qf->q_bits = MIN_Q_BITS;
+    while (((1 << qf->q_bits) / 4) * 3 < capacity_hint) {
+        qf->q_bits++;
+    }
+    assert(qf->q_bits + R_BITS <= 64);
+    qf->count = 0;
+    qf->max_count = ((1 << qf->q_bits) / 4) * 3;
+    qf->slots = calloc(1 << qf->q_bits, sizeof(uint16_t));
+    assert(qf->slots != NULL);
+}
+
+/* O(1) */
+void quotient_filter_dispose(quotient_filter *qf)
+{
+    free(qf->slots);
+}
+
+static uint32_t incr(const quotient_filter *qf, uint32_t slot)
+{
+    return (slot + 1) & ((1u << qf->q_bits) - 1);
+}
+
+static uint32_t decr(const quotient_filter *qf, uint32_t slot)
+{
+    return (slot - 1) & ((1u << qf->q_bits) - 1);
+}
+
+static uint32_t quotient_of(const quotient_filter *qf, uint64_t hash)
+{
+    return (uint32_t)(hash >> (64 - qf->q_bits));
+}
+
+static uint16_t remainder_of(const quotient_filter *qf, uint64_t hash)
+{
+    return (hash >> (64 - qf->q_bits - R_BITS)) & ((1 << R_BITS) - 1);
+}
+
+static bool is_empty(uint16_t entry)
+{
+    return (entry & METADATA) == 0;
+}
+
+/* Return the slot where the run of the quotient fq starts. */
+static uint32_t find_run_start(const quotient_filter *qf, uint32_t fq)
+{
+    uint32_t b, s;
+
+    // Walk back to the start of the cluster, the first unshifted slot
+    b = fq;
+    while (qf->slots[b] & SHIFTED) {
+        b = decr(qf, b);
+    }
+    // Walk forward run by run: s tracks the runs, b their quotients
+    s = b;
+    while (b != fq) {
+        do {
+            s = incr(qf, s);
+        } while (qf->slots[s] & CONTINUATION);
+        do {
+            b = incr(qf, b);
+        } while (!(qf->slots[b] & OCCUPIED));
+    }
+    return s;
+}
+
+/*
+ * Store entry at slot s and shift everything up to the next empty slot
+ * right by one. The occupied bit belongs to the slot, not to the entry,
+ * so it stays behind.
+ */
+static void insert_into(quotient_filter *qf, uint32_t s, uint16_t entry)
+{
+    uint16_t prev;
+    bool empty;
+
+    do {
+        prev = qf->slots[s];
+        empty = is_empty(prev);
+        if (!empty) {
+            prev |= SHIFTED;
+            if (prev & OCCUPIED) {
+                entry |= OCCUPIED;
+                prev &= ~OCCUPIED;
+            }
+        }
+        qf->slots[s] = entry;
+        entry = prev;
+        s = incr(qf, s);
+    } while (!empty);
+}
+
+/* O(cluster length) */
+bool quotient_filter_insert(quotient_filter *qf, uint64_t hash)
+{
+    uint32_t fq, start, s;
+    uint16_t fr, canonical, entry, rem;
+
+    if (qf->count >= qf->max_count) {
+        return false;
+    }
+    fq = quotient_of(qf, hash);
+    fr = remainder_of(qf, hash);
+    canonical = qf->slots[fq];
+    entry = fr << 3;
+
+    if (is_empty(canonical)) {
+        qf->slots[fq] = entry | OCCUPIED;
+        qf->count++;
+        return true;
+    }
+    if (!(canonical & OCCUPIED)) {
+        qf->slots[fq] |= OCCUPIED;
+    }
+    start = find_run_start(qf, fq);
+    s = start;
+
+    if (canonical & OCCUPIED) {
+        // Keep the run sorted: skip the smaller remainders
+        do {
+            rem = qf->slots[s] >> 3;
+            if (rem == fr) {
+                return true; // already present
+            }
+            if (rem > fr) {
+                break;
+            }
+            s = incr(qf, s);
+        } while (qf->slots[s] & CONTINUATION);
+
+        if (s == start) {
+            qf->slots[start] |= CONTINUATION; // the old head moves down
+        }
+        else {
+            entry |= CONTINUATION;
+        }
+    }
+    if (s != fq) {
+        entry |= SHIFTED;
+    }
+    insert_into(qf, s, entry);
+    qf->count++;
+    return true;
+}
+
+/* O(cluster length) */
+bool quotient_filter_may_contain(const quotient_filter *qf, uint64_t hash)
+{
+    uint32_t fq, s;
+    uint16_t fr, rem;
+
+    fq = quotient_of(qf, hash);
+    fr = remainder_of(qf, hash);
+    if (!(qf->slots[fq] & OCCUPIED)) {
+        return false;
+    }
+    s = find_run_start(qf, fq);
+    do {
+        rem = qf->slots[s] >> 3;
+        if (rem == fr) {
+            return true;
+        }
+        if (rem > fr) {
+            return false;
+        }
+        s = incr(qf, s);
+    } while (qf->slots[s] & CONTINUATION);
+    return false;
+}
+
+typedef struct {
+    uint64_t xor_mask; // xor of the hashes of the codes using this slot
+    int count; // number of codes using this slot
+} xor_set;
+
+static uint64_t xor_hash(const xor_filter *xf, uint64_t hash)
+{
+    return hash_u64(hash ^ xf->seed);
+}
+
+static uint8_t xor_fingerprint(uint64_t h)
+{
+    return (uint8_t)(h ^ (h >> 32));
+}
+
+static int xor_slot(const xor_filter *xf, uint64_t h, int block)
+{
+    uint64_t rotated = block == 0 ? h : (h << (21 * block)) | (h >> (64 - 21 * block));
+    return block * xf->block_length + hash_reduce(rotated, xf->block_length);
+}
+
+/*
+ * Try to peel all n codes with the current seed.
+ * On success, stack holds the codes' hashes in peeling order along with
+ * the slot each one was peeled from.
+ */
+static bool xor_peel(xor_filter *xf, const uint64_t hashes[], int n,
+                     xor_set sets[], uint64_t stack_hashes[], int stack_slots[])
+{
+    int i, block, slot, other, n_queue = 0, n_stack = 0;
+    int capacity = 3 * xf->block_length;
+    int *queue;
+    uint64_t h;
+
+    memset(sets, 0, capacity * sizeof(xor_set));
+    for (i = 0; i < n; i++) {
+        h = xor_hash(xf, hashes[i]);
+        for (block = 0; block < 3; block++) {
+            slot = xor_slot(xf, h, block);
+            sets[slot].xor_mask ^= h;
+            sets[slot].count++;
+        }
+    }
+    queue = malloc(capacity * sizeof(int));
+    assert(queue != NULL);
+    for (i = 0; i < capacity; i++) {
+        if (sets[i].count == 1) {
+            queue[n_queue++] = i;
+        }
+    }
+    while (n_queue > 0) {
+        slot = queue[--n_queue];
+        if (sets[slot].count != 1) {
+            continue; // emptied since it was queued
+        }
+        h = sets[slot].xor_mask;
+        stack_hashes[n_stack] = h;
+        stack_slots[n_stack++] = slot;
+        for (block = 0; block < 3; block++) {
+            other = xor_slot(xf, h, block);
+            sets[other].xor_mask ^= h;
+            sets[other].count--;
+            if (sets[other].count == 1) {
+                queue[n_queue++] = other;
+            }
+        }
+    }
+    free(queue);
+    return n_stack == n;
+}
+
+/* Expected O(n) */
+bool xor_filter_build(xor_filter *xf, const uint64_t hashes[], int n)
+{
+    int i, attempt, capacity;
+    bool peeled = false;
+    xor_set *sets;
+    uint64_t *stack_hashes, h;
+    int *stack_slots;
+
+    assert(n >= 0);
+    xf->block_length = (32 + n + n / 4) / 3 + 1; // 1.23 * n slots and more
+    capacity = 3 * xf->block_length;
+    sets = malloc(capacity * sizeof(xor_set));
+    stack_hashes = malloc((n + 1) * sizeof(uint64_t));
+    stack_slots = malloc((n + 1) * sizeof(int));
+    xf->fingerprints = calloc(capacity, sizeof(uint8_t));
+    assert(sets && stack_hashes && stack_slots && xf->fingerprints);
+
+    for (attempt = 0; attempt < MAX_XOR_SEEDS && !peeled; attempt++) {
+        xf->seed = hash_u64(attempt + 1);
+        peeled = xor_peel(xf, hashes, n, sets, stack_hashes, stack_slots);
+    }
+    // Solve in reverse peeling order: every other slot of a code is
+    // final by the time the code's own slot is assigned.
+    for (i = n - 1; peeled && i >= 0; i--) {
+        h = stack_hashes[i];
+        xf->fingerprints[stack_slots[i]] = 0;
+        xf->fingerprints[stack_slots[i]] = xor_fingerprint(h) ^
+                                           xf->fingerprints[xor_slot(xf, h, 0)] ^
+                                           xf->fingerprints[xor_slot(xf, h, 1)] ^
+                                           xf->fingerprints[xor_slot(xf, h, 2)];
+    }
+    free(stack_slots);
+    free(stack_hashes);
+    free(sets);
+    if (!peeled) {
+        free(xf->fingerprints);
+        xf->fingerprints = NULL;
+    }
+    return peeled;
+}
+
+/* O(1) */
+void xor_filter_dispose(xor_filter *xf)
+{
+    free(xf->fingerprints);
+}
+
+/* O(1) */
+bool xor_filter_may_contain(const xor_filter *xf, uint64_t hash)
+{
+    uint64_t h = xor_hash(xf, hash);
+
+    return xor_fingerprint(h) == (xf->fingerprints[xor_slot(xf, h, 0)] ^
+                                  xf->fingerprints[xor_slot(xf, h, 1)] ^
+                                  xf->fingerprints[xor_slot(xf, h, 2)]);
+}
@@ -0,0 +1,76 @@
+/*
+* Approximate membership filter API.
+*
+* Motivation:
+* A filter answers "is this hash code in the set?" from a few bytes per
+* element. It may answer yes for a code that was never added (a false
+* positive) but never answers no for one that was. Placed in front of a
+* hashset, it turns most unsuccessful lookups into one or two cache line
+* loads instead of a bucket search.
+*
+* Two filters are provided:
+* 1. The quotient filter accepts insertions one at a time. It stores a
+*    13-bit remainder per element in 16-bit slots, about 2.7 bytes per
+*    element at the maximum load of 3/4, for a false positive rate below
+*    1 in 8000.
+* 2. The xor filter is built once from all the hash codes and is
+*    immutable. It stores about 1.23 bytes per element for a false
+*    positive rate of 1 in 256.
+*
+* Hash codes should be well mixed, e.g. built with hashfun.h.
+*
+* Author:
+* Elizabeth Howe
+*/
+
+#ifndef _HASHFILTER_H_
+#define _HASHFILTER_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+typedef struct quotient_filter {
+    uint16_t *slots; // remainder << 3 | occupied, continuation, shifted bits
+    int q_bits; // there are 2^q_bits slots
+    int count;
+    int max_count;
+} quotient_filter;
+
+typedef struct xor_filter {
+    uint8_t *fingerprints;
+    int block_length; // the fingerprints are 3 blocks of this length
+    uint64_t seed;
+} xor_filter;
+
+/*
+ * Construct an empty quotient filter in the caller's stack, sized to hold
+ * capacity_hint hash codes.
+ */
+void quotient_filter_new(quotient_filter *qf, int capacity_hint);
+
+/* Free up memory consumed by the quotient filter */
+void quotient_filter_dispose(quotient_filter *qf);
+
+/*
+ * Add a hash code to the filter.
+ * Return false, without adding it, if the filter is full; the client
+ * should build a larger filter.
+ */
+bool quotient_filter_insert(quotient_filter *qf, uint64_t hash);
+
+/* Return false if the hash code was definitely never added. */
+bool quotient_filter_may_contain(const quotient_filter *qf, uint64_t hash);
+
+/*
+ * Build an xor filter over the n distinct hash codes.
+ * Return false if the codes are not distinct.
+ */
+bool xor_filter_build(xor_filter *xf, const uint64_t hashes[], int n);
+
+/* Free up memory consumed by the xor filter */
+void xor_filter_dispose(xor_filter *xf);
+
+/* Return false if the hash code was definitely not in the build set. */
+bool xor_filter_may_contain(const xor_filter *xf, uint64_t hash);
+
+#endif
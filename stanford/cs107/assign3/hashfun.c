@@ -0,0 +1,113 @@
+/*
+* Implementation of the hash function building blocks.
+* Integers are mixed with the splitmix64 finalizer: two rounds of
+* multiply by an odd constant and xor-shift, so every input bit affects
+* every output bit.
+* Byte ranges are consumed 8 bytes at a time, each word scrambled by a
+* multiply and rotate before it is folded into the state (the murmur3
+* block step), and the state is finalized like an integer.
+*
+* Author:
+* Elizabeth Howe
+*/
+
+#include "hashfun.h"
+#include <assert.h>
+#include <string.h>
+
+static const uint64_t golden = 0x9e3779b97f4a7c15ULL;
+static const uint64_t scramble1 = 0x87c37b91114253d5ULL;
+static const uint64_t scramble2 = 0x4cf5ad432745937fULL;
+
+static uint64_t rotl(uint64_t x, int r)
+{
+    return (x << r) | (x >> (64 - r));
+}
+
+/* O(1) */
+uint64_t hash_u64(uint64_t x)
+{
+    x += golden;
+    x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    x = (x ^ (x >> 27)) * 0x94d049bb133111ebULL;
+    return x ^ (x >> 31);
+}
+
+/* O(1) */
+uint64_t hash_u32(uint32_t x)
+{
+    return hash_u64(x);
+}
+
+static uint64_t mix_word(uint64_t h, uint64_t w)
+{
+    w *= scramble1;
+    w = rotl(w, 31);
+    w *= scramble2;
+    h ^= w;
+    h = rotl(h, 27);
+    return h * 5 + 0x52dce729;
+}
+
+/* O(n) */
+uint64_t hash_bytes(const void *addr, size_t n, uint64_t seed)
+{
+    const unsigned char *p = addr;
+    uint64_t h, w;
+
+    h = seed ^ (n * golden);
+    while (n >= sizeof(w)) {
+        memcpy(&w, p, sizeof(w)); // unaligned load
+        h = mix_word(h, w);
+        p += sizeof(w);
+        n -= sizeof(w);
+    }
+    if (n > 0) {
+        w = 0;
+        memcpy(&w, p, n);
+        h = mix_word(h, w);
+    }
+    return hash_u64(h);
+}
+
+/*
+* O(n)
+* strlen is vectorized by the C library, so finding the end first and then
+* hashing whole words is faster than testing every byte for '\0'.
+*/
+uint64_t hash_string(const char *s)
+{
+    return hash_bytes(s, strlen(s), 0);
+}
+
+/* O(1) */
+uint64_t hash_combine(uint64_t seed, uint64_t h)
+{
+    return hash_u64(seed ^ (h + golden + (seed << 6) + (seed >> 2)));
+}
+
+/*
+* O(1)
+* Lemire's fastrange: the high half of h * num_buckets is uniform over
+* [0, num_buckets) when h is uniform over the 64-bit range.
+*/
+int hash_reduce(uint64_t h, int num_buckets)
+{
+    assert(num_buckets > 0);
+#ifdef __SIZEOF_INT128__
+    return (int)(((unsigned __int128)h * (uint64_t)num_buckets) >> 64);
+#else
+    return (int)(((h >> 32) * (uint64_t)num_buckets) >> 32);
+#endif
+}
+
+int hash_string_fun(const void *elem_addr, int num_buckets)
+{
+    return hash_reduce(hash_string(*(const char **)elem_addr), num_buckets);
+}
+
+int hash_int_fun(const void *elem_addr, int num_buckets)
+{
+    return hash_reduce(hash_u32(*(const unsigned int *)elem_addr),
+                       num_buckets);
+}
@@ -0,0 +1,60 @@
+/*
+* Hash function building blocks.
+*
+* Motivation:
+* Every hashset client writes its own hashset_hash_fun, and a hand rolled
+* "sum the characters modulo num_buckets" leaves most buckets empty.
+* These primitives mix their input well and return a 64-bit hash code.
+* hash_reduce maps a hash code onto [0, num_buckets) with a multiply and a
+* shift, which is cheaper than % and uses the well-mixed high bits.
+*
+* Usage: static int hash_point(const void *elem_addr, int num_buckets)
+*        {
+*            const struct point *p = elem_addr;
+*            uint64_t h = hash_combine(hash_u32(p->x), hash_u32(p->y));
+*            return hash_reduce(h, num_buckets);
+*        }
+*
+* The hashes are deterministic across runs, but not across machines of
+* different endianness.
+*
+* Author:
+* Elizabeth Howe
+*/
+
+#ifndef _HASHFUN_H_
+#define _HASHFUN_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+/* Hash a 32-bit integer. */
+uint64_t hash_u32(uint32_t x);
+
+/* Hash a 64-bit integer with a multiply-shift finalizer. */
+uint64_t hash_u64(uint64_t x);
+
+/* Hash n bytes starting at addr, a word at a time. */
+uint64_t hash_bytes(const void *addr, size_t n, uint64_t seed);
+
+/* Hash the characters of a C string, not including the '\0'. */
+uint64_t hash_string(const char *s);
+
+/*
+ * Fold the hash code h of one field into the running hash code seed
+ * of a struct. The order in which fields are combined matters.
+ */
+uint64_t hash_combine(uint64_t seed, uint64_t h);
+
+/* Map a hash code onto [0, num_buckets). */
+int hash_reduce(uint64_t h, int num_buckets);
+
+/*
+ * Ready-made hashset_hash_fun's for the most common element types.
+ * hash_string_fun expects elements of type char *, hash_int_fun elements
+ * of type int.
+ */
+int hash_string_fun(const void *elem_addr, int num_buckets);
+int hash_int_fun(const void *elem_addr, int num_buckets);
+
+#endif
@@ -17,10 +17,30 @@
 */
 
 #include "hashset.h"
+#include "image.h"
 #include <assert.h>
+#include <errno.h>
+#include <limits.h>
 #include <stdlib.h>
 #include <string.h>
 
+static const char hashset_magic[8] = "HSETIMG";
+
+enum {
+    HASHSET_IMAGE_VERSION = 1,
+};
+
+/*
+ * The header of a hashset image. It is followed by the n_buckets + 1
+ * bucket offsets and then by the elements, bucket by bucket.
+ */
+typedef struct {
+    image_header common;
+    uint64_t elem_size;
+    uint64_t n_buckets;
+    uint64_t count;
+} hashset_image;
+
 /*
 * O(B)
 * where B is the number of buckets
@@ -41,6 +61,13 @@ void hashset_new(hashset *h, int elem_size, int num_buckets,
 	h->count = 0;
 	h->hash_fun = hash_fun;
 	h->comp_fun = cmp_fun;
+	h->filter = NULL;
+	h->filter_hash_fun = NULL;
+	h->elem_size = elem_size;
+	h->image = NULL;
+	h->image_size = 0;
+	h->image_offsets = NULL;
+	h->image_elems = NULL;
 	h->array = (vector *)malloc(h->n_buckets * sizeof(vector));
 	assert(h->array != NULL);
 	for (i = 0; i < h->n_buckets; i++) {
@@ -48,6 +75,55 @@ void hashset_new(hashset *h, int elem_size, int num_buckets,
 	}
 }
 
+/* Return true if the bucket has not been copied out of the image yet */
+static bool in_image(const hashset *h, int bucket)
+{
+	return h->image != NULL && h->array[bucket].elems == NULL;
+}
+
+/* O(1) */
+int hashset_bucket_length(const hashset *h, int bucket)
+{
+	assert(bucket >= 0 && bucket < h->n_buckets);
+	if (in_image(h, bucket)) {
+		return h->image_offsets[bucket + 1] - h->image_offsets[bucket];
+	}
+	return vector_length(&h->array[bucket]);
+}
+
+/* O(1) */
+void *hashset_bucket_nth(const hashset *h, int bucket, int position)
+{
+	assert(bucket >= 0 && bucket < h->n_buckets);
+	if (in_image(h, bucket)) {
+		return h->image_elems +
+		       (h->image_offsets[bucket] + position) * h->elem_size;
+	}
+	return vector_nth(&h->array[bucket], position);
+}
+
+/*
+* O(N / B)
+* Return the vector of the bucket, copying it out of the image first if
+* it still lives there.
+*/
+static vector *bucket_vector(hashset *h, int bucket)
+{
+    int i, n;
+    const char *elems;
+
+	if (in_image(h, bucket)) {
+		// Once the vector exists, the bucket is no longer read from the image
+		n = hashset_bucket_length(h, bucket);
+		elems = hashset_bucket_nth(h, bucket, 0);
+		vector_new(&h->array[bucket], h->elem_size, NULL, n);
+		for (i = 0; i < n; i++) {
+			vector_append(&h->array[bucket], elems + i * h->elem_size);
+		}
+	}
+	return &h->array[bucket];
+}
+
 /*
 * O(N + B)
 * N = number of elements hashed
@@ -58,9 +134,18 @@ void hashset_dispose(hashset *h)
     int i;
 
 	for (i = 0; i < h->n_buckets; i++) {
-		vector_dispose(&h->array[i]);
+		if (!in_image(h, i)) {
+			vector_dispose(&h->array[i]);
+		}
 	}
 	free(h->array);
+	if (h->image != NULL) {
+		image_unmap(h->image, h->image_size);
+	}
+	if (h->filter != NULL) {
+		quotient_filter_dispose(h->filter);
+		free(h->filter);
+	}
 }
 
 /* O(1) */
@@ -75,15 +160,66 @@ int hashset_count(const hashset *h)
 */
 void hashset_map(hashset *h, hashset_map_fun mapfn, void *aux_data)
 {
-    int i;
+    int i, j;
 
 	assert (mapfn != NULL);
 
 	for (i = 0; i < h->n_buckets; i++) {
-		vector_map(&h->array[i], mapfn, aux_data);
+		if (in_image(h, i)) {
+			for (j = 0; j < hashset_bucket_length(h, i); j++) {
+				mapfn(hashset_bucket_nth(h, i, j), aux_data);
+			}
+		}
+		else {
+			vector_map(&h->array[i], mapfn, aux_data);
+		}
 	}
 }
 
+/* Map function used to add an element to the hashset's filter */
+static void add_to_filter(void *elem_addr, void *h)
+{
+	hashset *hs = h;
+	bool added;
+
+	added = quotient_filter_insert(hs->filter, hs->filter_hash_fun(elem_addr));
+	assert(added);
+}
+
+/* 
+* O(N + B)
+* Build a filter with room for the elements plus as many again.
+*/
+static void filter_rebuild(hashset *h)
+{
+	if (h->filter != NULL) {
+		quotient_filter_dispose(h->filter);
+	}
+	else {
+		h->filter = malloc(sizeof(quotient_filter));
+		assert(h->filter != NULL);
+	}
+	quotient_filter_new(h->filter, 2 * h->count);
+	hashset_map(h, add_to_filter, h);
+}
+
+/* Amortized O(1) */
+static void filter_insert(hashset *h, const void *elem_addr)
+{
+	if (!quotient_filter_insert(h->filter, h->filter_hash_fun(elem_addr))) {
+		filter_rebuild(h); // the new element is already in a bucket
+	}
+}
+
+/* O(N + B) */
+void hashset_use_filter(hashset *h, hashset_hash64_fun hash64_fun)
+{
+	assert(hash64_fun != NULL);
+
+	h->filter_hash_fun = hash64_fun;
+	filter_rebuild(h);
+}
+
 /* 
 * Expected: O(N / B), assuming hash fun evenly distributes elements 
 * N = number of elements hashed
@@ -93,18 +229,23 @@ void hashset_enter(hashset *h, const void *elem_addr)
 {
     int vec_position;
     int bucket;
+    vector *v;
 
 	bucket = (h->hash_fun)(elem_addr, h->n_buckets);
 	assert(bucket >= 0 && bucket < h->n_buckets);
 
-	vec_position = vector_search(&h->array[bucket], elem_addr, h->comp_fun, 0, true);
+	v = bucket_vector(h, bucket);
+	vec_position = vector_search(v, elem_addr, h->comp_fun, 0, true);
 	if (vec_position == -1) {
-		vector_append(&h->array[bucket], elem_addr);
+		vector_append(v, elem_addr);
 		h->count++;
-		vector_sort(&h->array[bucket], h->comp_fun);
+		vector_sort(v, h->comp_fun);
+		if (h->filter != NULL) {
+			filter_insert(h, elem_addr);
+		}
 	}
 	else {
-		vector_elem_replace(&h->array[bucket], elem_addr, vec_position);
+		vector_elem_replace(v, elem_addr, vec_position);
 	}
 }
 
@@ -118,13 +259,142 @@ void *hashset_lookup(const hashset *h, const void *elem_addr)
     int vec_position;
     int bucket;
 
+	if (h->filter != NULL &&
+	    !quotient_filter_may_contain(h->filter, h->filter_hash_fun(elem_addr))) {
+		return NULL;
+	}
 	bucket = (h->hash_fun)(elem_addr, h->n_buckets);
 	assert(bucket >= 0 && bucket < h->n_buckets);
 
+	if (in_image(h, bucket)) {
+		return bsearch(elem_addr, hashset_bucket_nth(h, bucket, 0),
+		               hashset_bucket_length(h, bucket), h->elem_size,
+		               h->comp_fun);
+	}
 	vec_position = vector_search(&h->array[bucket], elem_addr, h->comp_fun, 0, true);
 	if (vec_position == -1) {
 		return NULL;
 	}
 
     return vector_nth(&h->array[bucket], vec_position);
+}
+
+/*
+* O(N + B)
+* N = number of elements hashed
+* B = number of buckets
+*/
+bool hashset_save(const hashset *h, const char *path)
+{
+    int i, j;
+    hashset_image header;
+    uint64_t *offsets;
+    FILE *fp;
+    bool ok;
+
+	offsets = malloc((h->n_buckets + 1) * sizeof(uint64_t));
+	assert(offsets != NULL);
+	offsets[0] = 0;
+	for (i = 0; i < h->n_buckets; i++) {
+		offsets[i + 1] = offsets[i] + hashset_bucket_length(h, i);
+	}
+	memset(&header, 0, sizeof(header));
+	image_header_init(&header.common, hashset_magic, HASHSET_IMAGE_VERSION);
+	header.elem_size = h->elem_size;
+	header.n_buckets = h->n_buckets;
+	header.count = h->count;
+
+	fp = fopen(path, "wb");
+	if (fp == NULL) {
+		free(offsets);
+		return false;
+	}
+	ok = image_write_section(fp, &header, sizeof(header)) &&
+	     image_write_section(fp, offsets, (h->n_buckets + 1) * sizeof(uint64_t));
+	// Buckets are sorted, so the elements can be written one by one
+	for (i = 0; i < h->n_buckets && ok; i++) {
+		for (j = 0; j < hashset_bucket_length(h, i) && ok; j++) {
+			ok = fwrite(hashset_bucket_nth(h, i, j), h->elem_size, 1, fp) == 1;
+		}
+	}
+	ok = ok && image_write_padding(fp, h->count * (size_t)h->elem_size);
+	if (fclose(fp) != 0) {
+		ok = false;
+	}
+	free(offsets);
+	return ok;
+}
+
+/* Return true if the mapped image is a well formed hashset image */
+static bool hashset_image_valid(const void *image, size_t size)
+{
+    const hashset_image *header = image;
+    const uint64_t *offsets;
+    size_t offsets_end;
+    uint64_t i;
+
+	if (!image_check(image, size, hashset_magic, HASHSET_IMAGE_VERSION,
+	                 sizeof(hashset_image)) ||
+	    header->elem_size == 0 || header->elem_size > INT_MAX ||
+	    header->n_buckets == 0 || header->n_buckets > INT_MAX ||
+	    header->count > INT_MAX) {
+		return false;
+	}
+	offsets_end = image_align(sizeof(hashset_image)) +
+	              image_align((header->n_buckets + 1) * sizeof(uint64_t));
+	if (size < offsets_end + header->count * header->elem_size) {
+		return false;
+	}
+	offsets = (const uint64_t *)((const char *)image +
+	                             image_align(sizeof(hashset_image)));
+	for (i = 0; i < header->n_buckets; i++) {
+		if (offsets[i] > offsets[i + 1]) {
+			return false;
+		}
+	}
+	return offsets[0] == 0 && offsets[header->n_buckets] == header->count;
+}
+
+/*
+* O(B)
+* B = number of buckets
+*/
+bool hashset_load(hashset *h, const char *path, hashset_hash_fun hash_fun,
+                  hashset_cmp_fun cmp_fun)
+{
+    const hashset_image *header;
+    size_t size, offsets_start;
+    void *image;
+
+	assert(hash_fun != NULL);
+	assert(cmp_fun != NULL);
+
+	image = image_map(path, &size);
+	if (image == NULL) {
+		return false;
+	}
+	if (!hashset_image_valid(image, size)) {
+		image_unmap(image, size);
+		errno = EINVAL;
+		return false;
+	}
+	header = image;
+	offsets_start = image_align(sizeof(hashset_image));
+
+	h->n_buckets = header->n_buckets;
+	h->count = header->count;
+	h->hash_fun = hash_fun;
+	h->comp_fun = cmp_fun;
+	h->filter = NULL;
+	h->filter_hash_fun = NULL;
+	h->elem_size = header->elem_size;
+	h->image = image;
+	h->image_size = size;
+	h->image_offsets = (const uint64_t *)((char *)image + offsets_start);
+	h->image_elems = (char *)image + offsets_start +
+	                 image_align((h->n_buckets + 1) * sizeof(uint64_t));
+	// Zeroed vectors mark the buckets that are still in the image
+	h->array = calloc(h->n_buckets, sizeof(vector));
+	assert(h->array != NULL);
+	return true;
 }
\ No newline at end of file
@@ -42,6 +42,14 @@ typedef int (*hashset_hash_fun)(const void *elem_addr, int num_buckets);
  */
 typedef int (*hashset_cmp_fun)(const void *elem_addr1, const void *elem_addr2);
 
+/*
+ * A client-supplied function pointer mapping the element at the specified
+ * elem_addr to a 64-bit hash code, typically built with hashfun.h.
+ * As with hashset_hash_fun, equal elements must get equal hash codes.
+ * Used by hashset_freeze, which needs more bits than a bucket number.
+ */
+typedef uint64_t (*hashset_hash64_fun)(const void *elem_addr);
+
 /* 
  * A client-supplied function pointer used to map over the elements in 
  * hashset.  
@@ -111,5 +119,111 @@ void *hashset_lookup(const hashset *h, const void *elem_addr);
  * If no additiona data is needed, aux_data is NULL.  
  */
 void hashset_map(hashset *h, hashset_map_fun map_fun, void *aux_data);
+
+/*
+ * Put an approximate membership filter in front of hashset_lookup.
+ * Most lookups of absent elements are then answered by the filter, from
+ * about 3 bytes per element, without calling the client hash_fun or
+ * searching a bucket.
+ *
+ * hash64_fun gives each element its hash code, as for hashset_freeze.
+ * The filter is a quotient filter that hashset_enter keeps up to date
+ * and rebuilds, twice as large, when it fills up.
+ * A hashset frozen from a filtered hashset gets an xor filter built over
+ * its hash codes.
+ */
+void hashset_use_filter(hashset *h, hashset_hash64_fun hash64_fun);
+
+/*
+ * Usage: hashset_frozen f;
+ *        if (!hashset_freeze(&h, &f, my_hash64)) { keep using h }
+ *
+ * Build a compact read-only copy of the hashset in f, for sets that are
+ * built once and then queried many times.
+ * The elements are copied into one contiguous array, in the order given
+ * by a minimal perfect hash over their hash codes. A lookup then costs one
+ * hash, one slot load and one compare. Besides the elements, the frozen
+ * set needs about 5 bits per element.
+ *
+ * hash64_fun gives each element its hash code. Distinct elements must get
+ * distinct codes, otherwise no perfect hash exists and false is returned.
+ * If hash64_fun is NULL, the code is derived from the hashset's hash_fun
+ * called with INT_MAX buckets; with only 31 bits, sets of more than a few
+ * thousand elements are likely to contain two equal codes.
+ *
+ * The frozen set holds shallow copies of the elements and never calls the
+ * free_fun. If the elements own memory, h must outlive f.
+ * Return false, leaving f untouched, if the perfect hash cannot be built.
+ */
+bool hashset_freeze(const hashset *h, hashset_frozen *f,
+                    hashset_hash64_fun hash64_fun);
+
+/* Free up memory consumed by the frozen hashset */
+void hashset_frozen_dispose(hashset_frozen *f);
+
+/* Return the number of elements residing in the frozen hashset. */
+int hashset_frozen_count(const hashset_frozen *f);
+
+/*
+ * Examine the frozen hashset to see if anything matches the item residing
+ * at the specified elem_addr.
+ * If a match is found, return the address of the stored item.
+ * If no match is found, return NULL.
+ */
+void *hashset_frozen_lookup(const hashset_frozen *f, const void *elem_addr);
+
+/*
+ * Apply the specified map_fun to the addresses of each element residing
+ * in the frozen hashset, in slot order.
+ */
+void hashset_frozen_map(hashset_frozen *f, hashset_map_fun map_fun,
+                        void *aux_data);
+
+/*
+ * Usage: if (!hashset_save(&h, "words.img")) { perror("words.img"); }
+ *
+ * Write the elements of the hashset to a binary image file at path,
+ * bucket by bucket, along with the number of buckets.
+ * The elements are written byte for byte, so they must be plain old data:
+ * no free_fun and no pointers. The filter, if any, is not saved.
+ * Return false on an I/O error, with errno set.
+ */
+bool hashset_save(const hashset *h, const char *path);
+
+/*
+ * Construct a hashset in the caller's stack from an image written by
+ * hashset_save. hash_fun and cmp_fun must be the functions the saved
+ * hashset used, since the elements stay in the buckets they were in.
+ *
+ * The image is mapped rather than read, and no element is re-entered:
+ * a lookup searches the bucket in place, and a bucket is only copied to
+ * the heap the first time an element is entered into it. Loading costs
+ * O(B), not O(N). The loaded hashset has no filter and no free_fun.
+ * Return false, with errno set, if the file cannot be mapped or is not a
+ * hashset image of this version.
+ */
+bool hashset_load(hashset *h, const char *path, hashset_hash_fun hash_fun,
+                  hashset_cmp_fun cmp_fun);
+
+/*
+ * Write the frozen hashset, perfect hash and xor filter included, to a
+ * binary image file at path. As for hashset_save, the elements must be
+ * plain old data. Return false on an I/O error, with errno set.
+ */
+bool hashset_frozen_save(const hashset_frozen *f, const char *path);
+
+/*
+ * Construct a frozen hashset from an image written by hashset_frozen_save.
+ * hash_fun, hash64_fun and cmp_fun must be the functions the saved set
+ * was frozen with. The image holds no pointers, so it is mapped and used
+ * in place: loading only reads the remap table, one int per position
+ * past the members, to check that each names a slot in range.
+ * Return false, with errno set, if the file cannot be mapped or is not a
+ * frozen hashset image of this version.
+ */
+bool hashset_frozen_load(hashset_frozen *f, const char *path,
+                         hashset_hash_fun hash_fun,
+                         hashset_hash64_fun hash64_fun,
+                         hashset_cmp_fun cmp_fun);
      
 #endif
\ No newline at end of file
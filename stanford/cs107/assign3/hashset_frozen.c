@@ -0,0 +1,526 @@
+/*
+* Implementation of the frozen hashset in C.
+* Internally, the elements are stored contiguously in one array and a
+* minimal perfect hash maps each element's hash code to its slot.
+*
+* The perfect hash follows PTHash (Pibiri and Trani, 2021):
+* 1. The hash codes are split into n_pilots buckets, about 4 per bucket.
+* 2. Largest bucket first, each bucket searches for the smallest pilot
+*    such that position(code, pilot) is free for every code in the bucket.
+* 3. Positions range over [0, n_positions), a few percent more than the
+*    number of elements, which keeps the pilots small. The few elements
+*    placed at a position past count are remapped to the free slots
+*    below count, so the final slots are exactly [0, count).
+* A lookup computes the bucket of the code, loads its pilot, computes the
+* position and, if needed, remaps it.
+* If the source hashset had a filter, an xor filter over the hash codes is
+* built along with the perfect hash and checked before the slot is loaded.
+*
+* Author:
+* Elizabeth Howe
+*/
+
+#include "hashset.h"
+#include "hashfun.h"
+#include "image.h"
+#include <assert.h>
+#include <errno.h>
+#include <limits.h>
+#include <stdlib.h>
+#include <string.h>
+
+static const char frozen_magic[8] = "FSETIMG";
+
+enum {
+    KEYS_PER_PILOT = 4,
+    SLACK_DIVISOR = 32, // n_positions is about count * (1 + 1/32)
+    MAX_PILOT = UINT16_MAX,
+    MAX_SEEDS = 16, // seeds to try before giving up
+    FROZEN_IMAGE_VERSION = 1,
+};
+
+/*
+ * The header of a frozen hashset image. It is followed by the pilots, the
+ * remap table, the elements and the filter fingerprints, if any, each
+ * starting on an IMAGE_ALIGN boundary. Nothing in it is a pointer, so the
+ * mapped arrays are used in place.
+ */
+typedef struct {
+    image_header common;
+    uint64_t seed;
+    uint64_t filter_seed;
+    uint32_t elem_size;
+    uint32_t count;
+    uint32_t n_pilots;
+    uint32_t n_positions;
+    uint32_t filter_block_length; // 0 if there is no filter
+    uint32_t unused;
+} frozen_image;
+
+static uint64_t frozen_code(hashset_hash64_fun hash64_fun,
+                            hashset_hash_fun hash_fun, const void *elem_addr)
+{
+    if (hash64_fun != NULL) {
+        return hash64_fun(elem_addr);
+    }
+    return (uint64_t)hash_fun(elem_addr, INT_MAX);
+}
+
+/* The key is the code mixed with the seed. Distinct codes give distinct keys. */
+static uint64_t frozen_key(uint64_t code, uint64_t seed)
+{
+    return hash_u64(code ^ seed);
+}
+
+static int frozen_position(uint64_t key, int pilot, int n_positions)
+{
+    return hash_reduce(hash_u64(key ^ ((uint64_t)pilot * 0x9e3779b97f4a7c15ULL)),
+                       n_positions);
+}
+
+static int cmp_key(const void *p1, const void *p2)
+{
+    uint64_t k1 = *(const uint64_t *)p1;
+    uint64_t k2 = *(const uint64_t *)p2;
+    return (k1 > k2) - (k1 < k2);
+}
+
+/*
+ * Search pilots for every bucket, largest bucket first.
+ * keys holds the keys grouped by bucket: bucket b owns
+ * keys[first[b]] through keys[first[b + 1] - 1].
+ * On success, positions[i] holds the position of keys[i].
+ * Return false if some bucket has no pilot that fits.
+ */
+static bool search_pilots(hashset_frozen *f, const uint64_t keys[],
+                          const int first[], int positions[])
+{
+    int i, j, b, k, size, max_size, pilot;
+    int *by_size, *size_first;
+    bool fits;
+    char *taken;
+
+    // Counting sort of the buckets by decreasing size
+    max_size = 0;
+    for (b = 0; b < f->n_pilots; b++) {
+        size = first[b + 1] - first[b];
+        if (size > max_size) {
+            max_size = size;
+        }
+    }
+    size_first = calloc(max_size + 2, sizeof(int));
+    by_size = malloc(f->n_pilots * sizeof(int));
+    taken = calloc(f->n_positions, 1);
+    assert(size_first != NULL && by_size != NULL && taken != NULL);
+    for (b = 0; b < f->n_pilots; b++) {
+        size_first[max_size - (first[b + 1] - first[b]) + 1]++;
+    }
+    for (i = 1; i <= max_size + 1; i++) {
+        size_first[i] += size_first[i - 1];
+    }
+    for (b = 0; b < f->n_pilots; b++) {
+        by_size[size_first[max_size - (first[b + 1] - first[b])]++] = b;
+    }
+
+    for (i = 0; i < f->n_pilots; i++) {
+        b = by_size[i];
+        if (first[b + 1] == first[b]) {
+            f->pilots[b] = 0;
+            continue;
+        }
+        for (pilot = 0; pilot <= MAX_PILOT; pilot++) {
+            fits = true;
+            for (k = first[b]; k < first[b + 1] && fits; k++) {
+                positions[k] = frozen_position(keys[k], pilot, f->n_positions);
+                if (taken[positions[k]]) {
+                    fits = false;
+                }
+                for (j = first[b]; j < k && fits; j++) {
+                    if (positions[j] == positions[k]) {
+                        fits = false;
+                    }
+                }
+            }
+            if (fits) {
+                break;
+            }
+        }
+        if (pilot > MAX_PILOT) {
+            break;
+        }
+        f->pilots[b] = pilot;
+        for (k = first[b]; k < first[b + 1]; k++) {
+            taken[positions[k]] = 1;
+        }
+    }
+    free(taken);
+    free(by_size);
+    free(size_first);
+    return i == f->n_pilots;
+}
+
+/*
+ * Fill in the remap table so that positions past count land in the free
+ * slots below count.
+ */
+static void fill_remap(hashset_frozen *f, const int positions[])
+{
+    int i, free_slot;
+    char *taken;
+
+    taken = calloc(f->n_positions, 1);
+    assert(taken != NULL);
+    for (i = 0; i < f->count; i++) {
+        taken[positions[i]] = 1;
+    }
+    free_slot = 0;
+    for (i = f->count; i < f->n_positions; i++) {
+        f->remap[i - f->count] = 0; // never used by a member
+        if (!taken[i]) {
+            continue;
+        }
+        while (taken[free_slot]) {
+            free_slot++;
+        }
+        f->remap[i - f->count] = free_slot++;
+    }
+    free(taken);
+}
+
+static int frozen_slot(const hashset_frozen *f, uint64_t key)
+{
+    int bucket, position;
+
+    bucket = hash_reduce(key, f->n_pilots);
+    position = frozen_position(key, f->pilots[bucket], f->n_positions);
+    if (position >= f->count) {
+        position = f->remap[position - f->count];
+    }
+    return position;
+}
+
+/*
+ * Build the pilots and the remap table of f over the count hash codes.
+ * Return false if two codes are equal or if no seed gives a perfect hash.
+ */
+static bool build_perfect_hash(hashset_frozen *f, const uint64_t codes[])
+{
+    int i, b, attempt;
+    int *first, *positions, *order;
+    uint64_t *keys;
+    bool distinct = true, built = false;
+
+    keys = malloc((f->count + 1) * sizeof(uint64_t));
+    positions = malloc((f->count + 1) * sizeof(int));
+    order = malloc((f->count + 1) * sizeof(int));
+    first = malloc((f->n_pilots + 1) * sizeof(int));
+    f->pilots = malloc(f->n_pilots * sizeof(uint16_t));
+    f->remap = malloc((f->n_positions - f->count) * sizeof(int));
+    assert(keys != NULL && positions != NULL && order != NULL);
+    assert(first != NULL && f->pilots != NULL && f->remap != NULL);
+
+    // No perfect hash can separate equal codes
+    memcpy(keys, codes, f->count * sizeof(uint64_t));
+    qsort(keys, f->count, sizeof(uint64_t), cmp_key);
+    for (i = 1; i < f->count; i++) {
+        if (keys[i] == keys[i - 1]) {
+            distinct = false;
+        }
+    }
+
+    for (attempt = 0; distinct && attempt < MAX_SEEDS && !built; attempt++) {
+        f->seed = hash_u64(attempt);
+
+        // Counting sort of the element indexes by perfect hash bucket
+        memset(first, 0, (f->n_pilots + 1) * sizeof(int));
+        for (i = 0; i < f->count; i++) {
+            b = hash_reduce(frozen_key(codes[i], f->seed), f->n_pilots);
+            first[b + 1]++;
+        }
+        for (b = 0; b < f->n_pilots; b++) {
+            first[b + 1] += first[b];
+        }
+        for (i = 0; i < f->count; i++) {
+            b = hash_reduce(frozen_key(codes[i], f->seed), f->n_pilots);
+            order[first[b]++] = i;
+        }
+        // first[b] now holds the end of bucket b, shift it back to the start
+        for (b = f->n_pilots; b > 0; b--) {
+            first[b] = first[b - 1];
+        }
+        first[0] = 0;
+        for (i = 0; i < f->count; i++) {
+            keys[i] = frozen_key(codes[order[i]], f->seed);
+        }
+        built = search_pilots(f, keys, first, positions);
+    }
+    if (built) {
+        fill_remap(f, positions);
+    }
+    else {
+        free(f->pilots);
+        free(f->remap);
+    }
+    free(first);
+    free(order);
+    free(positions);
+    free(keys);
+    return built;
+}
+
+/*
+* Expected O(N + B)
+* N = number of elements hashed
+* B = number of buckets of the hashset
+*/
+bool hashset_freeze(const hashset *h, hashset_frozen *f,
+                    hashset_hash64_fun hash64_fun)
+{
+    int i, j, b, slot;
+    uint64_t *codes;
+    bool built;
+    hashset_frozen frozen;
+
+    memset(&frozen, 0, sizeof(frozen));
+    frozen.elem_size = h->elem_size;
+    frozen.count = h->count;
+    frozen.n_pilots = h->count / KEYS_PER_PILOT + 1;
+    frozen.n_positions = h->count + h->count / SLACK_DIVISOR + 1;
+    frozen.comp_fun = h->comp_fun;
+    frozen.hash_fun = h->hash_fun;
+    frozen.hash64_fun = hash64_fun;
+
+    // codes[i] belongs to the i-th element in bucket order
+    codes = malloc((h->count + 1) * sizeof(uint64_t));
+    assert(codes != NULL);
+    for (i = 0, b = 0; b < h->n_buckets; b++) {
+        for (j = 0; j < hashset_bucket_length(h, b); j++) {
+            codes[i++] = frozen_code(hash64_fun, h->hash_fun,
+                                     hashset_bucket_nth(h, b, j));
+        }
+    }
+
+    built = build_perfect_hash(&frozen, codes);
+    if (built) {
+        frozen.elems = malloc((size_t)(h->count + 1) * frozen.elem_size);
+        assert(frozen.elems != NULL);
+        for (i = 0, b = 0; b < h->n_buckets; b++) {
+            for (j = 0; j < hashset_bucket_length(h, b); j++, i++) {
+                slot = frozen_slot(&frozen, frozen_key(codes[i], frozen.seed));
+                memcpy((char *)frozen.elems + (size_t)slot * frozen.elem_size,
+                       hashset_bucket_nth(h, b, j), frozen.elem_size);
+            }
+        }
+        if (h->filter != NULL) {
+            frozen.filter = malloc(sizeof(xor_filter));
+            assert(frozen.filter != NULL);
+            built = xor_filter_build(frozen.filter, codes, h->count);
+            assert(built); // the perfect hash proved the codes distinct
+        }
+        *f = frozen;
+    }
+    free(codes);
+    return built;
+}
+
+/* O(1) */
+void hashset_frozen_dispose(hashset_frozen *f)
+{
+    if (f->image != NULL) {
+        image_unmap(f->image, f->image_size);
+        free(f->filter); // the fingerprints were in the image
+        return;
+    }
+    free(f->elems);
+    free(f->pilots);
+    free(f->remap);
+    if (f->filter != NULL) {
+        xor_filter_dispose(f->filter);
+        free(f->filter);
+    }
+}
+
+/* O(1) */
+int hashset_frozen_count(const hashset_frozen *f)
+{
+    return f->count;
+}
+
+/* O(1) */
+void *hashset_frozen_lookup(const hashset_frozen *f, const void *elem_addr)
+{
+    int slot;
+    uint64_t code;
+    char *stored;
+
+    if (f->count == 0) {
+        return NULL;
+    }
+    code = frozen_code(f->hash64_fun, f->hash_fun, elem_addr);
+    if (f->filter != NULL && !xor_filter_may_contain(f->filter, code)) {
+        return NULL;
+    }
+    slot = frozen_slot(f, frozen_key(code, f->seed));
+    stored = (char *)f->elems + (size_t)slot * f->elem_size;
+    if (f->comp_fun(elem_addr, stored) != 0) {
+        return NULL;
+    }
+    return stored;
+}
+
+/* O(N) */
+void hashset_frozen_map(hashset_frozen *f, hashset_map_fun map_fun,
+                        void *aux_data)
+{
+    int i;
+
+    assert(map_fun != NULL);
+
+    for (i = 0; i < f->count; i++) {
+        map_fun((char *)f->elems + (size_t)i * f->elem_size, aux_data);
+    }
+}
+
+/* O(N) */
+bool hashset_frozen_save(const hashset_frozen *f, const char *path)
+{
+    frozen_image header;
+    FILE *fp;
+    bool ok;
+
+    memset(&header, 0, sizeof(header));
+    image_header_init(&header.common, frozen_magic, FROZEN_IMAGE_VERSION);
+    header.seed = f->seed;
+    header.elem_size = f->elem_size;
+    header.count = f->count;
+    header.n_pilots = f->n_pilots;
+    header.n_positions = f->n_positions;
+    if (f->filter != NULL) {
+        header.filter_seed = f->filter->seed;
+        header.filter_block_length = f->filter->block_length;
+    }
+
+    fp = fopen(path, "wb");
+    if (fp == NULL) {
+        return false;
+    }
+    ok = image_write_section(fp, &header, sizeof(header)) &&
+         image_write_section(fp, f->pilots, f->n_pilots * sizeof(uint16_t)) &&
+         image_write_section(fp, f->remap,
+                             (f->n_positions - f->count) * sizeof(int)) &&
+         image_write_section(fp, f->elems, (size_t)f->count * f->elem_size);
+    if (ok && f->filter != NULL) {
+        ok = image_write_section(fp, f->filter->fingerprints,
+                                 3 * (size_t)f->filter->block_length);
+    }
+    if (fclose(fp) != 0) {
+        ok = false;
+    }
+    return ok;
+}
+
+/*
+* Return the size of a frozen image with the given header, or 0 if the
+* header is inconsistent.
+*/
+static size_t frozen_image_size(const frozen_image *header)
+{
+    if (header->elem_size == 0 || header->elem_size > INT_MAX ||
+        header->count > INT_MAX || header->n_positions > INT_MAX ||
+        header->n_positions <= header->count ||
+        header->n_pilots != header->count / KEYS_PER_PILOT + 1 ||
+        header->filter_block_length > INT_MAX / 3) {
+        return 0;
+    }
+    return image_align(sizeof(frozen_image)) +
+           image_align(header->n_pilots * sizeof(uint16_t)) +
+           image_align((header->n_positions - header->count) * sizeof(int)) +
+           image_align((size_t)header->count * header->elem_size) +
+           image_align(3 * (size_t)header->filter_block_length);
+}
+
+/*
+ * Return true if every remap entry names a member slot. With no members
+ * the table is never read, so there is nothing to check.
+ */
+static bool remap_in_range(const hashset_frozen *f)
+{
+    int i;
+
+    if (f->count == 0) {
+        return true;
+    }
+    for (i = 0; i < f->n_positions - f->count; i++) {
+        if (f->remap[i] < 0 || f->remap[i] >= f->count) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/*
+ * O(P - N) to check the remap table, for P positions and N members; the
+ * other pages are read in as lookups touch them
+ */
+bool hashset_frozen_load(hashset_frozen *f, const char *path,
+                         hashset_hash_fun hash_fun,
+                         hashset_hash64_fun hash64_fun,
+                         hashset_cmp_fun cmp_fun)
+{
+    const frozen_image *header;
+    size_t size, expected_size;
+    char *image, *p;
+
+    assert(hash_fun != NULL || hash64_fun != NULL);
+    assert(cmp_fun != NULL);
+
+    image = image_map(path, &size);
+    if (image == NULL) {
+        return false;
+    }
+    header = (const frozen_image *)image;
+    expected_size = 0;
+    if (image_check(image, size, frozen_magic, FROZEN_IMAGE_VERSION,
+                    sizeof(frozen_image))) {
+        expected_size = frozen_image_size(header);
+    }
+    if (expected_size == 0 || size < expected_size) {
+        image_unmap(image, size);
+        errno = EINVAL;
+        return false;
+    }
+
+    memset(f, 0, sizeof(*f));
+    f->elem_size = header->elem_size;
+    f->count = header->count;
+    f->n_pilots = header->n_pilots;
+    f->n_positions = header->n_positions;
+    f->seed = header->seed;
+    f->comp_fun = cmp_fun;
+    f->hash_fun = hash_fun;
+    f->hash64_fun = hash64_fun;
+    f->image = image;
+    f->image_size = size;
+
+    p = image + image_align(sizeof(frozen_image));
+    f->pilots = (uint16_t *)p;
+    p += image_align(f->n_pilots * sizeof(uint16_t));
+    f->remap = (int *)p;
+    p += image_align((f->n_positions - f->count) * sizeof(int));
+    f->elems = p;
+    p += image_align((size_t)f->count * f->elem_size);
+    if (!remap_in_range(f)) {
+        image_unmap(image, size);
+        memset(f, 0, sizeof(*f));
+        errno = EINVAL;
+        return false;
+    }
+    if (header->filter_block_length > 0) {
+        f->filter = malloc(sizeof(xor_filter));
+        assert(f->filter != NULL);
+        f->filter->fingerprints = (uint8_t *)p;
+        f->filter->block_length = header->filter_block_length;
+        f->filter->seed = header->filter_seed;
+    }
+    return true;
+}
@@ -3,6 +3,10 @@
 * Elizabeth Howe
 */
 
+#include <stddef.h>
+#include <stdint.h>
+#include "hashfilter.h"
+
 /* The internal representation of a hashset */
 typedef struct {
     vector *array;
@@ -10,4 +14,37 @@ typedef struct {
     int count; // number of elements that have been hashed 
     int (*comp_fun)(const void *, const void *);
     int (*hash_fun)(const void *, int);
-} hashset;
\ No newline at end of file
+    quotient_filter *filter; // NULL unless hashset_use_filter was called
+    uint64_t (*filter_hash_fun)(const void *);
+    int elem_size;
+    void *image; // mapping of a loaded hashset, NULL if it was never saved
+    size_t image_size;
+    const uint64_t *image_offsets; // bucket b is image_elems[offsets[b]..[b + 1])
+    char *image_elems;
+} hashset;
+
+/* The internal representation of a frozen hashset */
+typedef struct {
+    void *elems; // count elements, in the slot order of the perfect hash
+    uint16_t *pilots; // one displacement per perfect hash bucket
+    int *remap; // slot for each position past count
+    int elem_size;
+    int count;
+    int n_pilots;
+    int n_positions; // count plus some slack, to make the build fast
+    uint64_t seed;
+    int (*comp_fun)(const void *, const void *);
+    int (*hash_fun)(const void *, int);
+    uint64_t (*hash64_fun)(const void *);
+    xor_filter *filter; // NULL unless the source hashset used a filter
+    void *image; // mapping the arrays point into, NULL if they are malloc'd
+    size_t image_size;
+} hashset_frozen;
+
+/*
+ * Bucket access for the modules built on the hashset.
+ * A bucket of a loaded hashset stays in the image, with array[b].elems
+ * NULL, until the first write to it.
+ */
+int hashset_bucket_length(const hashset *h, int bucket);
+void *hashset_bucket_nth(const hashset *h, int bucket, int position);
\ No newline at end of file
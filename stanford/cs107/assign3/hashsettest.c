@@ -6,10 +6,14 @@
 */
 
 #include "hashset.h"
+#include "hashstats.h"
+#include "hashfun.h"
+#include "hashfilter.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <ctype.h>
 #include <limits.h>
+#include <string.h>
 #include <assert.h>
 
 const int kNumBuckets = 26;
@@ -34,6 +38,20 @@ static int HashFrequency(const void *elem, int numBuckets)
   return (freq->ch % numBuckets);
 }
 
+/**
+ * Function: HashFrequencyMixed
+ * ----------------------------
+ * The same partitioning built from the library hash helpers.  The char is
+ * mixed into a 64-bit hash code, which hash_reduce maps onto the range
+ * 0 to numBuckets - 1 for any char, negative ones included.
+ */
+
+static int HashFrequencyMixed(const void *elem, int numBuckets)
+{
+  struct frequency *freq = (struct frequency *)elem;
+  return hash_reduce(hash_u32((unsigned char)freq->ch), numBuckets);
+}
+
 /**
  * Function: PrintFrequency
  * -------------------------
@@ -170,9 +188,289 @@ static void TestHashTable(void)
   hashset_dispose(&counts);
 }
 
+/**
+ * Function: TestHashQuality
+ * -------------------------
+ * Runs HashFrequency over a sample holding one frequency per lowercase
+ * letter and prints the diagnostics report.  Each bit of each sample
+ * element is flipped to measure the avalanche score; flipping the high
+ * bit of a char makes it negative, which exposes that HashFrequency can
+ * return a negative hash code.  Then reports the occupancy of the table
+ * built from the letters of this file.  HashFrequencyMixed gets the same
+ * treatment and must come out clean.
+ */
+static void TestHashQuality(void)
+{
+  vector sample;
+  hashset counts;
+  hashset_hash_report report;
+  struct frequency localFreq;
+  char ch;
+
+  fprintf(stdout, "\n\n ------------------------- Starting the HashQuality test\n");
+  vector_new(&sample, sizeof(struct frequency), NULL, 26);
+  for (ch = 'a'; ch <= 'z'; ch++) {
+    memset(&localFreq, 0, sizeof(localFreq)); // padding bits are compared
+    localFreq.ch = ch;
+    vector_append(&sample, &localFreq);
+  }
+  hashset_analyze(&sample, kNumBuckets, HashFrequency, CompareLetter, true, &report);
+  fprintf(stdout, "HashFrequency over the alphabet: ");
+  hashset_report_print(stdout, &report);
+  assert(report.longest == 1 && report.n_empty == 0);
+  assert(report.flags == HASH_OUT_OF_RANGE);
+
+  hashset_analyze(&sample, 2 * kNumBuckets, HashFrequency, CompareLetter, false, &report);
+  fprintf(stdout, "HashFrequency with twice the buckets: ");
+  hashset_report_print(stdout, &report);
+  assert(report.n_empty == kNumBuckets);
+
+  hashset_analyze(&sample, kNumBuckets, HashFrequencyMixed, CompareLetter, true, &report);
+  fprintf(stdout, "HashFrequencyMixed over the alphabet: ");
+  hashset_report_print(stdout, &report);
+  assert(report.flags == 0);
+  vector_dispose(&sample);
+
+  hashset_new(&counts, sizeof(struct frequency), kNumBuckets, HashFrequency, CompareLetter, NULL);
+  BuildTableOfLetterCounts(&counts);
+  hashset_stats(&counts, &report);
+  fprintf(stdout, "Occupancy of the letter count table: ");
+  hashset_report_print(stdout, &report);
+  assert(report.n_elems == hashset_count(&counts));
+  hashset_dispose(&counts);
+}
+
+/**
+ * Functions: HashInt, HashInt64, HashConstant64, CompareInt
+ * ---------------------------------------------------------
+ * Hash and compare functions for a hashset of ints.  HashConstant64 gives
+ * every element the same hash code, so no perfect hash can exist for it.
+ */
+
+static int HashInt(const void *elem, int numBuckets)
+{
+  return hash_int_fun(elem, numBuckets);
+}
+
+static uint64_t HashInt64(const void *elem)
+{
+  return hash_u32(*(const int *)elem);
+}
+
+static uint64_t HashConstant64(const void *elem)
+{
+  return 42;
+}
+
+static int CompareInt(const void *elem1, const void *elem2)
+{
+  int n1 = *(const int *)elem1, n2 = *(const int *)elem2;
+  return (n1 > n2) - (n1 < n2);
+}
+
+/**
+ * Function: TestFrozenHashTable
+ * -----------------------------
+ * Freezes the letter count table, deriving the hash codes from
+ * HashFrequency, and checks that every letter is found with its count and
+ * that non-letters are not found.  Then freezes a large set of ints, where
+ * the 31-bit derived codes are not good enough and HashInt64 is supplied,
+ * and checks membership of every int in and around the set.  Finally
+ * checks that a hash code shared by all elements is refused.
+ */
+static void TestFrozenHashTable(void)
+{
+  hashset counts, numbers;
+  hashset_frozen frozenCounts, frozenNumbers;
+  struct frequency localFreq, *found, *frozenFound;
+  const int kNumNumbers = 300007;
+  int i, number, *foundNumber;
+  char ch;
+
+  fprintf(stdout, "\n\n ------------------------- Starting the FrozenHashTable test\n");
+  hashset_new(&counts, sizeof(struct frequency), kNumBuckets, HashFrequency, CompareLetter, NULL);
+  BuildTableOfLetterCounts(&counts);
+  assert(hashset_freeze(&counts, &frozenCounts, NULL));
+  assert(hashset_frozen_count(&frozenCounts) == hashset_count(&counts));
+  for (ch = 'a'; ch <= 'z'; ch++) {
+    localFreq.ch = ch;
+    found = hashset_lookup(&counts, &localFreq);
+    frozenFound = hashset_frozen_lookup(&frozenCounts, &localFreq);
+    assert(found != NULL && frozenFound != NULL);
+    assert(found->occurrences == frozenFound->occurrences);
+  }
+  localFreq.ch = '#';
+  assert(hashset_frozen_lookup(&frozenCounts, &localFreq) == NULL);
+  fprintf(stdout, "Here are the contents of the frozen table:\n");
+  hashset_frozen_map(&frozenCounts, PrintFrequency, stdout);
+  hashset_frozen_dispose(&frozenCounts);
+  hashset_dispose(&counts);
+
+  hashset_new(&numbers, sizeof(int), 10007, HashInt, CompareInt, NULL);
+  for (i = 0; i < kNumNumbers; i++) {
+    number = 3 * i;
+    hashset_enter(&numbers, &number);
+  }
+  assert(hashset_freeze(&numbers, &frozenNumbers, HashInt64));
+  assert(hashset_frozen_count(&frozenNumbers) == kNumNumbers);
+  for (number = -3; number < 3 * kNumNumbers + 3; number++) {
+    foundNumber = hashset_frozen_lookup(&frozenNumbers, &number);
+    assert((foundNumber != NULL) == (number >= 0 && number % 3 == 0 && number < 3 * kNumNumbers));
+    assert(foundNumber == NULL || *foundNumber == number);
+  }
+  fprintf(stdout, "Froze %d ints, all found.\n", kNumNumbers);
+  hashset_frozen_dispose(&frozenNumbers);
+
+  assert(!hashset_freeze(&numbers, &frozenNumbers, HashConstant64));
+  fprintf(stdout, "Refused to freeze with a constant hash code.\n");
+  hashset_dispose(&numbers);
+}
+
+/**
+ * Function: TestFilters
+ * ---------------------
+ * Fills a quotient filter until it refuses more hash codes and builds an
+ * xor filter over the same codes.  Neither may forget a code, and their
+ * false positive rates over codes never added must be near the design
+ * rates (1 in 8000 and 1 in 256).  Then puts a filter in front of a
+ * hashset of ints, starting from an empty set so that the filter is
+ * rebuilt several times, and checks lookups around the set, both live and
+ * frozen.
+ */
+static void TestFilters(void)
+{
+  const int kNumCodes = 100000;
+  quotient_filter qf;
+  xor_filter xf;
+  uint64_t *codes;
+  hashset numbers;
+  hashset_frozen frozenNumbers;
+  int i, number, count, falsePositives;
+  bool member;
+
+  fprintf(stdout, "\n\n ------------------------- Starting the Filters test\n");
+  quotient_filter_new(&qf, kNumCodes);
+  codes = malloc(2 * kNumCodes * sizeof(uint64_t));
+  assert(codes != NULL);
+  for (count = 0; ; count++) {
+    codes[count] = hash_u64(count);
+    if (!quotient_filter_insert(&qf, codes[count])) break;
+  }
+  assert(count >= kNumCodes);
+  for (i = 0; i < count; i++)
+    assert(quotient_filter_may_contain(&qf, codes[i]));
+  for (falsePositives = 0, i = 0; i < count; i++)
+    falsePositives += quotient_filter_may_contain(&qf, hash_u64(i + count));
+  fprintf(stdout, "Quotient filter took %d codes, %d false positives.\n", count, falsePositives);
+  assert(falsePositives < count / 2000);
+  quotient_filter_dispose(&qf);
+
+  assert(xor_filter_build(&xf, codes, count));
+  for (i = 0; i < count; i++)
+    assert(xor_filter_may_contain(&xf, codes[i]));
+  for (falsePositives = 0, i = 0; i < count; i++)
+    falsePositives += xor_filter_may_contain(&xf, hash_u64(i + count));
+  fprintf(stdout, "Xor filter built over %d codes, %d false positives.\n", count, falsePositives);
+  assert(falsePositives < count / 128);
+  xor_filter_dispose(&xf);
+  free(codes);
+
+  hashset_new(&numbers, sizeof(int), 1009, HashInt, CompareInt, NULL);
+  hashset_use_filter(&numbers, HashInt64);
+  for (number = 0; number < 3 * kNumCodes; number += 3)
+    hashset_enter(&numbers, &number);
+  assert(hashset_freeze(&numbers, &frozenNumbers, HashInt64));
+  for (number = -3; number < 3 * kNumCodes + 3; number++) {
+    member = number >= 0 && number % 3 == 0 && number < 3 * kNumCodes;
+    assert((hashset_lookup(&numbers, &number) != NULL) == member);
+    assert((hashset_frozen_lookup(&frozenNumbers, &number) != NULL) == member);
+  }
+  fprintf(stdout, "Filtered hashset of %d ints, all found.\n", kNumCodes);
+  hashset_frozen_dispose(&frozenNumbers);
+  hashset_dispose(&numbers);
+}
+
+/**
+ * Function: TestImages
+ * --------------------
+ * Saves the letter count table to an image and loads it back, checking
+ * every letter and entering into the loaded table, which copies a bucket
+ * out of the image.  Then saves a frozen set of ints, with its filter,
+ * and checks membership around the set after loading it.
+ */
+static void TestImages(void)
+{
+  const char *kImageFile = "hashsettest.img";
+  const int kNumNumbers = 100000;
+  hashset counts, loadedCounts, numbers;
+  hashset_frozen frozenNumbers, loadedNumbers;
+  struct frequency localFreq, *found, *loadedFound;
+  int number;
+  bool member;
+  char ch;
+
+  fprintf(stdout, "\n\n ------------------------- Starting the Images test\n");
+  hashset_new(&counts, sizeof(struct frequency), kNumBuckets, HashFrequency, CompareLetter, NULL);
+  BuildTableOfLetterCounts(&counts);
+  assert(hashset_save(&counts, kImageFile));
+  assert(hashset_load(&loadedCounts, kImageFile, HashFrequency, CompareLetter));
+  remove(kImageFile); // the mapping outlives the file
+  assert(hashset_count(&loadedCounts) == hashset_count(&counts));
+  for (ch = 'a'; ch <= 'z'; ch++) {
+    localFreq.ch = ch;
+    found = hashset_lookup(&counts, &localFreq);
+    loadedFound = hashset_lookup(&loadedCounts, &localFreq);
+    assert(found != NULL && loadedFound != NULL);
+    assert(found->occurrences == loadedFound->occurrences);
+  }
+  localFreq.ch = '#';
+  localFreq.occurrences = 1;
+  assert(hashset_lookup(&loadedCounts, &localFreq) == NULL);
+  hashset_enter(&loadedCounts, &localFreq);
+  assert(hashset_count(&loadedCounts) == hashset_count(&counts) + 1);
+  assert(hashset_lookup(&loadedCounts, &localFreq) != NULL);
+  for (ch = 'a'; ch <= 'z'; ch++) {
+    localFreq.ch = ch;
+    found = hashset_lookup(&counts, &localFreq);
+    loadedFound = hashset_lookup(&loadedCounts, &localFreq);
+    assert(loadedFound != NULL);
+    assert(found->occurrences == loadedFound->occurrences);
+  }
+  fprintf(stdout, "Here are the contents of the loaded table:\n");
+  hashset_map(&loadedCounts, PrintFrequency, stdout);
+  hashset_dispose(&loadedCounts);
+  hashset_dispose(&counts);
+
+  hashset_new(&numbers, sizeof(int), 1009, HashInt, CompareInt, NULL);
+  hashset_use_filter(&numbers, HashInt64);
+  for (number = 0; number < 3 * kNumNumbers; number += 3)
+    hashset_enter(&numbers, &number);
+  assert(hashset_freeze(&numbers, &frozenNumbers, HashInt64));
+  assert(hashset_frozen_save(&frozenNumbers, kImageFile));
+  assert(hashset_frozen_load(&loadedNumbers, kImageFile, HashInt, HashInt64, CompareInt));
+  remove(kImageFile);
+  assert(hashset_frozen_count(&loadedNumbers) == kNumNumbers);
+  for (number = -3; number < 3 * kNumNumbers + 3; number++) {
+    member = number >= 0 && number % 3 == 0 && number < 3 * kNumNumbers;
+    assert((hashset_frozen_lookup(&loadedNumbers, &number) != NULL) == member);
+  }
+  fprintf(stdout, "Saved and loaded a frozen set of %d ints, all found.\n", kNumNumbers);
+  hashset_frozen_dispose(&loadedNumbers);
+  hashset_frozen_dispose(&frozenNumbers);
+  hashset_dispose(&numbers);
+
+  assert(!hashset_load(&counts, "hashsettest.c", HashFrequency, CompareLetter));
+  assert(!hashset_frozen_load(&frozenNumbers, "hashsettest.c", HashInt, HashInt64, CompareInt));
+  fprintf(stdout, "Refused to load a file that is not an image.\n");
+}
+
 int main(int ununsed, char **alsoUnused) 
 {
   TestHashTable();	
+  TestHashQuality();
+  TestFrozenHashTable();
+  TestFilters();
+  TestImages();
   return 0;
 }
 
@@ -0,0 +1,225 @@
+/*
+* Implementation of the hash function diagnostics.
+* The sample is hashed into an array of bucket counters, which is all
+* that is needed for the occupancy statistics. The expected values are
+* those of balls thrown uniformly at random into the buckets.
+*
+* The projected lookup cost models hashset_lookup, which binary searches
+* the bucket: a bucket holding k elements costs about floor(log2(k)) + 1
+* comparisons.
+*
+* Author:
+* Elizabeth Howe
+*/
+
+#include "hashstats.h"
+#include <assert.h>
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+static const double avalanche_threshold = 0.5;
+static const double outlier_sigmas = 4.0;
+
+static int search_cost(int bucket_size)
+{
+    int cost = 0;
+
+    while (bucket_size > 0) {
+        cost++;
+        bucket_size >>= 1;
+    }
+    return cost;
+}
+
+/* O(B) */
+static void fill_occupancy(hashset_hash_report *r, const int counts[],
+                           int n_buckets, int n_elems)
+{
+    int i, occupied = 0;
+    long hit_comparisons = 0, miss_comparisons = 0;
+    double sum_sq = 0.0, delta, chi_square, dof;
+
+    memset(r, 0, sizeof(*r));
+    r->n_elems = n_elems;
+    r->n_buckets = n_buckets;
+    r->mean = (double)n_elems / n_buckets;
+    r->avalanche_score = -1.0;
+
+    for (i = 0; i < n_buckets; i++) {
+        if (counts[i] == 0) {
+            r->n_empty++;
+            continue;
+        }
+        occupied++;
+        if (counts[i] > r->longest) {
+            r->longest = counts[i];
+        }
+        delta = counts[i] - r->mean;
+        sum_sq += delta * delta;
+        hit_comparisons += (long)counts[i] * search_cost(counts[i]);
+        miss_comparisons += search_cost(counts[i]);
+    }
+    sum_sq += r->n_empty * r->mean * r->mean;
+    r->variance = sum_sq / n_buckets;
+
+    r->expected_empty = n_buckets * pow(1.0 - 1.0 / n_buckets, n_elems);
+    r->expected_variance = r->mean * (1.0 - 1.0 / n_buckets);
+    r->collisions = n_elems - occupied;
+    r->expected_collisions = n_elems - (n_buckets - r->expected_empty);
+    if (r->expected_collisions > 0.5) {
+        r->collision_score = r->collisions / r->expected_collisions;
+    }
+    else {
+        r->collision_score = r->collisions == 0 ? 1.0 : r->collisions;
+    }
+    r->hit_cost = n_elems == 0 ? 0.0 : (double)hit_comparisons / n_elems;
+    r->miss_cost = (double)miss_comparisons / n_buckets;
+
+    if (n_elems == 0) {
+        return;
+    }
+    if (r->n_empty > r->expected_empty +
+                     outlier_sigmas * sqrt(r->expected_empty) + 1.0) {
+        r->flags |= HASH_EMPTY_BUCKETS;
+    }
+    // The occupancy follows a chi-square distribution with B - 1 degrees of
+    // freedom under an ideal hash. Flag anything several deviations above.
+    if (n_buckets > 1) {
+        chi_square = r->variance * n_buckets / r->mean;
+        dof = n_buckets - 1;
+        if (chi_square - dof > outlier_sigmas * sqrt(2.0 * dof)) {
+            r->flags |= HASH_SKEWED;
+        }
+    }
+}
+
+/*
+* O(N + B) without flip_bits
+* O(N * S + B) with flip_bits
+* N = number of elements in the sample
+* S = number of bits in an element
+*/
+void hashset_analyze(const vector *sample, int num_buckets,
+                     hashset_hash_fun hash_fun, hashset_cmp_fun cmp_fun,
+                     bool flip_bits, hashset_hash_report *report)
+{
+    int i, bit, bucket, flipped_bucket, n_elems, elem_size;
+    int flags = 0;
+    long tested = 0, moved = 0;
+    int *counts;
+    char *elem, *flipped;
+
+    assert(num_buckets > 0);
+    assert(hash_fun != NULL);
+    assert(cmp_fun != NULL);
+
+    n_elems = vector_length(sample);
+    elem_size = sample->elem_size;
+    counts = calloc(num_buckets, sizeof(int));
+    assert(counts != NULL);
+    flipped = malloc(elem_size);
+    assert(flipped != NULL);
+
+    for (i = 0; i < n_elems; i++) {
+        elem = vector_nth(sample, i);
+        bucket = hash_fun(elem, num_buckets);
+        if (bucket < 0 || bucket >= num_buckets) {
+            flags |= HASH_OUT_OF_RANGE;
+            continue;
+        }
+        if (hash_fun(elem, num_buckets) != bucket) {
+            flags |= HASH_NONDETERMINISTIC;
+        }
+        counts[bucket]++;
+
+        if (!flip_bits) {
+            continue;
+        }
+        for (bit = 0; bit < elem_size * 8; bit++) {
+            memcpy(flipped, elem, elem_size);
+            flipped[bit / 8] ^= 1 << (bit % 8);
+            if (cmp_fun(flipped, elem) == 0) {
+                continue; // the bit is not part of the element's identity
+            }
+            tested++;
+            flipped_bucket = hash_fun(flipped, num_buckets);
+            if (flipped_bucket < 0 || flipped_bucket >= num_buckets) {
+                flags |= HASH_OUT_OF_RANGE;
+            }
+            if (flipped_bucket != bucket) {
+                moved++;
+            }
+        }
+    }
+
+    fill_occupancy(report, counts, num_buckets, n_elems);
+    report->flags |= flags;
+    if (tested > 0 && num_buckets > 1) {
+        report->avalanche_score = ((double)moved / tested) /
+                                  (1.0 - 1.0 / num_buckets);
+        if (report->avalanche_score < avalanche_threshold) {
+            report->flags |= HASH_POOR_AVALANCHE;
+        }
+    }
+    free(flipped);
+    free(counts);
+}
+
+/* O(B) */
+void hashset_stats(const hashset *h, hashset_hash_report *report)
+{
+    int i;
+    int *counts;
+
+    counts = malloc(h->n_buckets * sizeof(int));
+    assert(counts != NULL);
+    for (i = 0; i < h->n_buckets; i++) {
+        counts[i] = hashset_bucket_length(h, i);
+    }
+    fill_occupancy(report, counts, h->n_buckets, h->count);
+    free(counts);
+}
+
+/* O(1) */
+bool hashset_report_degenerate(const hashset_hash_report *report)
+{
+    return report->flags != 0;
+}
+
+void hashset_report_print(FILE *fp, const hashset_hash_report *r)
+{
+    fprintf(fp, "%d elements in %d buckets (mean %.2f)\n",
+            r->n_elems, r->n_buckets, r->mean);
+    fprintf(fp, "  empty buckets:   %d (expected %.1f)\n",
+            r->n_empty, r->expected_empty);
+    fprintf(fp, "  longest bucket:  %d\n", r->longest);
+    fprintf(fp, "  variance:        %.2f (expected %.2f)\n",
+            r->variance, r->expected_variance);
+    fprintf(fp, "  collisions:      %d (expected %.1f, score %.2f)\n",
+            r->collisions, r->expected_collisions, r->collision_score);
+    if (r->avalanche_score >= 0.0) {
+        fprintf(fp, "  avalanche score: %.2f\n", r->avalanche_score);
+    }
+    fprintf(fp, "  lookup cost:     %.2f comparisons per hit, "
+                "%.2f per miss\n", r->hit_cost, r->miss_cost);
+    if (r->flags == 0) {
+        fprintf(fp, "  no problems detected\n");
+        return;
+    }
+    if (r->flags & HASH_OUT_OF_RANGE) {
+        fprintf(fp, "  DEGENERATE: hash codes outside [0, %d)\n", r->n_buckets);
+    }
+    if (r->flags & HASH_NONDETERMINISTIC) {
+        fprintf(fp, "  DEGENERATE: hash is not deterministic\n");
+    }
+    if (r->flags & HASH_EMPTY_BUCKETS) {
+        fprintf(fp, "  DEGENERATE: too many empty buckets\n");
+    }
+    if (r->flags & HASH_SKEWED) {
+        fprintf(fp, "  DEGENERATE: bucket occupancy is skewed\n");
+    }
+    if (r->flags & HASH_POOR_AVALANCHE) {
+        fprintf(fp, "  DEGENERATE: changing an element rarely moves it\n");
+    }
+}
@@ -0,0 +1,83 @@
+/*
+* Hash function diagnostics API.
+*
+* Motivation:
+* A hashset is only as fast as its client's hash function. A hash that
+* leaves most buckets empty turns every lookup into a long bucket search.
+* These routines feed a sample of elements through a client hash function
+* (or inspect a populated hashset) and report how evenly the elements were
+* spread, so that degenerate hashes are caught before they are deployed.
+*
+* Author:
+* Elizabeth Howe
+*/
+
+#ifndef _HASHSTATS_H_
+#define _HASHSTATS_H_
+
+#include <stdio.h>
+#include <stdbool.h>
+#include "hashset.h"
+
+/* Bits set in hashset_hash_report.flags when a problem is detected. */
+enum {
+    HASH_OUT_OF_RANGE = 1 << 0,    // a code fell outside [0, num_buckets)
+    HASH_NONDETERMINISTIC = 1 << 1, // hashing an element twice disagreed
+    HASH_EMPTY_BUCKETS = 1 << 2,   // far more empty buckets than expected
+    HASH_SKEWED = 1 << 3,          // occupancy variance far above uniform
+    HASH_POOR_AVALANCHE = 1 << 4,  // single-bit changes rarely move buckets
+};
+
+/*
+ * The result of an analysis.
+ * Expected values are those of an ideal hash that places every element
+ * in a bucket chosen uniformly at random.
+ */
+typedef struct {
+    int n_elems; // number of elements hashed
+    int n_buckets;
+    int n_empty; // buckets that received no element
+    double expected_empty;
+    int longest; // number of elements in the fullest bucket
+    double mean; // n_elems / n_buckets
+    double variance; // variance of the bucket occupancy
+    double expected_variance;
+    int collisions; // elements that landed in an already occupied bucket
+    double expected_collisions;
+    double collision_score; // collisions / expected_collisions, ideal is 1
+    double avalanche_score; // observed / ideal bucket moves, -1 if not run
+    double hit_cost; // projected comparisons per successful lookup
+    double miss_cost; // projected comparisons per unsuccessful lookup
+    int flags; // HASH_* bits, 0 if no problem was detected
+} hashset_hash_report;
+
+/*
+ * Hash every element of the sample vector into num_buckets buckets
+ * with hash_fun and fill in the report.
+ *
+ * cmp_fun is used to decide whether two elements are the same element.
+ *
+ * If flip_bits is true, the avalanche score is measured by flipping each
+ * bit of each element in turn and checking how often the bucket changes.
+ * Only flips that produce a different element (according to cmp_fun) are
+ * counted. flip_bits must only be set for elements that are plain old data;
+ * an element holding a pointer would hand hash_fun a corrupted address.
+ */
+void hashset_analyze(const vector *sample, int num_buckets,
+                     hashset_hash_fun hash_fun, hashset_cmp_fun cmp_fun,
+                     bool flip_bits, hashset_hash_report *report);
+
+/*
+ * Fill in the occupancy part of the report for a populated hashset.
+ * No hash function is called, so the avalanche score is not measured.
+ * O(B)
+ */
+void hashset_stats(const hashset *h, hashset_hash_report *report);
+
+/* Return true if any problem was detected. */
+bool hashset_report_degenerate(const hashset_hash_report *report);
+
+/* Print a human readable form of the report to fp. */
+void hashset_report_print(FILE *fp, const hashset_hash_report *report);
+
+#endif
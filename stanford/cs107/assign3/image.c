@@ -0,0 +1,100 @@
+/*
+* Implementation of the binary image helpers.
+* Images are mapped with MAP_PRIVATE, so a container loaded from an image
+* can be modified in place; the kernel copies the touched pages.
+*
+* Author:
+* Elizabeth Howe
+*/
+
+#include "image.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+static const uint32_t IMAGE_BYTE_ORDER = 0x01020304;
+
+void image_header_init(image_header *header, const char magic[8],
+                       uint32_t version)
+{
+    memset(header, 0, sizeof(*header));
+    memcpy(header->magic, magic, sizeof(header->magic));
+    header->version = version;
+    header->byte_order = IMAGE_BYTE_ORDER;
+}
+
+size_t image_align(size_t n)
+{
+    return (n + IMAGE_ALIGN - 1) / IMAGE_ALIGN * IMAGE_ALIGN;
+}
+
+bool image_write_section(FILE *fp, const void *addr, size_t n)
+{
+    if (n > 0 && fwrite(addr, 1, n, fp) != n) {
+        return false;
+    }
+    return image_write_padding(fp, n);
+}
+
+bool image_write_padding(FILE *fp, size_t n)
+{
+    static const char zeros[IMAGE_ALIGN];
+
+    n = image_align(n) - n;
+    return n == 0 || fwrite(zeros, 1, n, fp) == n;
+}
+
+void *image_map(const char *path, size_t *size)
+{
+    int fd, saved_errno;
+    struct stat st;
+    void *image;
+
+    fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        return NULL;
+    }
+    if (fstat(fd, &st) < 0) {
+        saved_errno = errno;
+        close(fd);
+        errno = saved_errno;
+        return NULL;
+    }
+    if (st.st_size == 0) {
+        close(fd);
+        errno = EINVAL;
+        return NULL;
+    }
+    image = mmap(NULL, st.st_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+    saved_errno = errno;
+    close(fd); // the mapping keeps the file alive
+    if (image == MAP_FAILED) {
+        errno = saved_errno;
+        return NULL;
+    }
+    *size = st.st_size;
+    return image;
+}
+
+void image_unmap(void *image, size_t size)
+{
+    munmap(image, size);
+}
+
+bool image_check(const void *image, size_t size, const char magic[8],
+                 uint32_t version, size_t header_size)
+{
+    const image_header *header = image;
+
+    if (size < header_size || size < sizeof(image_header) ||
+        memcmp(header->magic, magic, sizeof(header->magic)) != 0 ||
+        header->version != version ||
+        header->byte_order != IMAGE_BYTE_ORDER) {
+        errno = EINVAL;
+        return false;
+    }
+    return true;
+}
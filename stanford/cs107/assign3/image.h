@@ -0,0 +1,72 @@
+/*
+* Binary image helpers shared by the vector and hashset serializers.
+*
+* Motivation:
+* An image holds a container of plain old data elements exactly as it is
+* laid out in memory, so that loading it is a single mmap instead of
+* re-entering every element. Each image starts with a common header that
+* identifies the container type, the image version and the byte order
+* of the machine that wrote it.
+*
+* Author:
+* Elizabeth Howe
+*/
+
+#ifndef _IMAGE_H_
+#define _IMAGE_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+enum {
+    IMAGE_ALIGN = 64, // every section of an image starts on this boundary
+};
+
+/* The first bytes of every image */
+typedef struct {
+    char magic[8];
+    uint32_t version;
+    uint32_t byte_order; // IMAGE_BYTE_ORDER as seen by the writer
+} image_header;
+
+/* Fill in the common header. */
+void image_header_init(image_header *header, const char magic[8],
+                       uint32_t version);
+
+/* Round n up to the next multiple of IMAGE_ALIGN. */
+size_t image_align(size_t n);
+
+/*
+ * Write n bytes to fp, followed by zero padding up to the next
+ * IMAGE_ALIGN boundary. Return false on a write error.
+ */
+bool image_write_section(FILE *fp, const void *addr, size_t n);
+
+/*
+ * Write the zero padding that follows a section of n bytes written
+ * piecemeal by the caller. Return false on a write error.
+ */
+bool image_write_padding(FILE *fp, size_t n);
+
+/*
+ * Map the image file at path into memory, privately: writes to the
+ * mapping are never written back to the file.
+ * Return NULL on error, with errno set.
+ * On success, store the length of the mapping in size.
+ */
+void *image_map(const char *path, size_t *size);
+
+/* Unmap an image returned by image_map. */
+void image_unmap(void *image, size_t size);
+
+/*
+ * Return true if the mapped image is at least header_size bytes long and
+ * starts with a header of the given magic and version written on a
+ * machine of the same byte order. Otherwise set errno to EINVAL.
+ */
+bool image_check(const void *image, size_t size, const char magic[8],
+                 uint32_t version, size_t header_size);
+
+#endif
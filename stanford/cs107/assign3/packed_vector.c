@@ -0,0 +1,240 @@
+/*
+* Implementation of the packed integer vector in C.
+* Elements are stored least significant bit first in an array of 64-bit
+* words. An element may straddle two words; the array has one spare word
+* at the end so that reading the second word of the last element is safe.
+*
+* Unpacking at widths that divide a byte or a multiple of bytes can work
+* on whole bytes: with SSE2, 16 bytes of 8-bit elements, or 8 bytes of
+* 4-bit elements split into nibbles, are widened to 32 bits with the
+* unpack instructions.
+*
+* Author:
+* Elizabeth Howe
+*/
+
+#include "packed_vector.h"
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+static const int default_capacity = 64;
+
+static size_t words_for(int capacity, int width)
+{
+    return ((size_t)capacity * width + 63) / 64 + 1; // plus the spare word
+}
+
+static int bits_needed(uint32_t value)
+{
+    int bits = 1;
+
+    while (bits < 32 && (value >> bits) != 0) {
+        bits++;
+    }
+    return bits;
+}
+
+static uint32_t mask_of(int width)
+{
+    return width == 32 ? UINT32_MAX : (1u << width) - 1;
+}
+
+/* O(1) */
+void packed_vector_new(packed_vector *pv, int width, int capacity_hint)
+{
+    assert(width >= 1 && width <= 32);
+    assert(capacity_hint >= 0);
+
+    pv->width = width;
+    pv->length = 0;
+    pv->capacity = capacity_hint == 0 ? default_capacity : capacity_hint;
+    pv->words = calloc(words_for(pv->capacity, pv->width), sizeof(uint64_t));
+    assert(pv->words != NULL);
+}
+
+/* O(1) */
+void packed_vector_dispose(packed_vector *pv)
+{
+    free(pv->words);
+}
+
+/* O(1) */
+int packed_vector_length(const packed_vector *pv)
+{
+    return pv->length;
+}
+
+/* O(1) */
+int packed_vector_width(const packed_vector *pv)
+{
+    return pv->width;
+}
+
+static uint32_t get_bits(const uint64_t words[], int width, int position)
+{
+    uint64_t bit = (uint64_t)position * width;
+    int offset = bit & 63;
+    uint64_t value = words[bit >> 6] >> offset;
+
+    if (offset + width > 64) {
+        value |= words[(bit >> 6) + 1] << (64 - offset);
+    }
+    return (uint32_t)value & mask_of(width);
+}
+
+static void set_bits(uint64_t words[], int width, int position,
+                     uint32_t value)
+{
+    uint64_t bit = (uint64_t)position * width;
+    int offset = bit & 63;
+    uint64_t mask = mask_of(width);
+
+    words[bit >> 6] = (words[bit >> 6] & ~(mask << offset)) |
+                      ((uint64_t)value << offset);
+    if (offset + width > 64) {
+        words[(bit >> 6) + 1] = (words[(bit >> 6) + 1] & ~(mask >> (64 - offset))) |
+                                ((uint64_t)value >> (64 - offset));
+    }
+}
+
+/* O(1) */
+uint32_t packed_vector_get(const packed_vector *pv, int position)
+{
+    assert(position >= 0 && position < pv->length);
+    return get_bits(pv->words, pv->width, position);
+}
+
+/*
+* O(n)
+* Repack the elements into new words of the given width and capacity.
+*/
+static void repack(packed_vector *pv, int width, int capacity)
+{
+    uint64_t *words;
+    int i;
+
+    if (width == pv->width) {
+        words = realloc(pv->words, words_for(capacity, width) * sizeof(uint64_t));
+        assert(words != NULL);
+        memset(words + words_for(pv->capacity, width), 0,
+               (words_for(capacity, width) - words_for(pv->capacity, width)) *
+               sizeof(uint64_t));
+    }
+    else {
+        words = calloc(words_for(capacity, width), sizeof(uint64_t));
+        assert(words != NULL);
+        for (i = 0; i < pv->length; i++) {
+            set_bits(words, width, i, get_bits(pv->words, pv->width, i));
+        }
+        free(pv->words);
+    }
+    pv->words = words;
+    pv->width = width;
+    pv->capacity = capacity;
+}
+
+/* O(1), or O(n) when the vector is widened */
+void packed_vector_set(packed_vector *pv, int position, uint32_t value)
+{
+    assert(position >= 0 && position < pv->length);
+
+    if (bits_needed(value) > pv->width) {
+        repack(pv, bits_needed(value), pv->capacity);
+    }
+    set_bits(pv->words, pv->width, position, value);
+}
+
+/* Amortized O(1) */
+void packed_vector_append(packed_vector *pv, uint32_t value)
+{
+    int width = pv->width, capacity = pv->capacity;
+
+    if (bits_needed(value) > width) {
+        width = bits_needed(value);
+    }
+    if (pv->length == capacity) {
+        capacity *= 2;
+    }
+    if (width != pv->width || capacity != pv->capacity) {
+        repack(pv, width, capacity);
+    }
+    pv->length++;
+    set_bits(pv->words, pv->width, pv->length - 1, value);
+}
+
+#ifdef __SSE2__
+/* Widen 16 bytes to 16 uint32_t */
+static void widen_bytes(__m128i bytes, uint32_t out[])
+{
+    __m128i zero = _mm_setzero_si128();
+    __m128i lo = _mm_unpacklo_epi8(bytes, zero);
+    __m128i hi = _mm_unpackhi_epi8(bytes, zero);
+
+    _mm_storeu_si128((__m128i *)out, _mm_unpacklo_epi16(lo, zero));
+    _mm_storeu_si128((__m128i *)(out + 4), _mm_unpackhi_epi16(lo, zero));
+    _mm_storeu_si128((__m128i *)(out + 8), _mm_unpacklo_epi16(hi, zero));
+    _mm_storeu_si128((__m128i *)(out + 12), _mm_unpackhi_epi16(hi, zero));
+}
+
+/*
+* Unpack as many elements as possible, 16 at a time, starting at start,
+* which must be byte aligned. Return the number unpacked.
+*/
+static int unpack_sse2(const packed_vector *pv, int start, int n,
+                       uint32_t out[])
+{
+    const unsigned char *bytes;
+    __m128i zero = _mm_setzero_si128();
+    __m128i v, nibbles, lo, hi;
+    int i = 0;
+
+    bytes = (const unsigned char *)pv->words + (size_t)start * pv->width / 8;
+    switch (pv->width) {
+    case 4:
+        for (; i + 16 <= n; i += 16, bytes += 8) {
+            v = _mm_loadl_epi64((const __m128i *)bytes);
+            lo = _mm_and_si128(v, _mm_set1_epi8(0x0f));
+            hi = _mm_and_si128(_mm_srli_epi16(v, 4), _mm_set1_epi8(0x0f));
+            nibbles = _mm_unpacklo_epi8(lo, hi); // low nibble first
+            widen_bytes(nibbles, out + i);
+        }
+        break;
+    case 8:
+        for (; i + 16 <= n; i += 16, bytes += 16) {
+            widen_bytes(_mm_loadu_si128((const __m128i *)bytes), out + i);
+        }
+        break;
+    case 16:
+        for (; i + 8 <= n; i += 8, bytes += 16) {
+            v = _mm_loadu_si128((const __m128i *)bytes);
+            _mm_storeu_si128((__m128i *)(out + i), _mm_unpacklo_epi16(v, zero));
+            _mm_storeu_si128((__m128i *)(out + i + 4), _mm_unpackhi_epi16(v, zero));
+        }
+        break;
+    }
+    return i;
+}
+#endif
+
+/* O(n) */
+void packed_vector_unpack(const packed_vector *pv, int start, int n,
+                          uint32_t out[])
+{
+    int i = 0;
+
+    assert(start >= 0 && n >= 0 && start + n <= pv->length);
+
+#ifdef __SSE2__
+    if ((pv->width == 4 || pv->width == 8 || pv->width == 16) &&
+        ((uint64_t)start * pv->width) % 8 == 0) {
+        i = unpack_sse2(pv, start, n, out);
+    }
+#endif
+    for (; i < n; i++) {
+        out[i] = get_bits(pv->words, pv->width, start + i);
+    }
+}
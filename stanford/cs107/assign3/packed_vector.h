@@ -0,0 +1,73 @@
+/*
+* Packed integer vector API.
+*
+* Motivation:
+* Counts and flags are usually stored as 32-bit ints even when every
+* value fits in a few bits. The packed vector stores unsigned integers of
+* a configurable width, from 1 to 32 bits, back to back in 64-bit words,
+* so a million 10-bit counts take 1.25MB instead of 4MB.
+* When a value does not fit in the current width, the vector is repacked
+* at the width of that value, so clients never have to know the maximum
+* value up front. There are at most 31 repackings in a vector's life.
+*
+* Author:
+* Elizabeth Howe
+*/
+
+#ifndef _PACKED_VECTOR_H_
+#define _PACKED_VECTOR_H_
+
+#include <stdint.h>
+
+/* The internal representation of a packed vector */
+typedef struct {
+    uint64_t *words; // element i is at bits [i * width, (i + 1) * width)
+    int width; // bits per element
+    int length;
+    int capacity; // elements the words can hold
+} packed_vector;
+
+/*
+ * Usage: packed_vector counts;
+ *        packed_vector_new(&counts, 4, 0);
+ *
+ * Construct an empty packed vector in the caller's stack, storing
+ * elements of width bits, between 1 and 32.
+ * capacity_hint is the number of elements to allocate room for, or 0 to
+ * let the implementation choose. The vector doubles its room as it grows.
+ */
+void packed_vector_new(packed_vector *pv, int width, int capacity_hint);
+
+/* Free up memory consumed by packed vector */
+void packed_vector_dispose(packed_vector *pv);
+
+/* Return the number of elements in the packed vector. */
+int packed_vector_length(const packed_vector *pv);
+
+/* Return the current number of bits per element. */
+int packed_vector_width(const packed_vector *pv);
+
+/* Return the element numbered position. */
+uint32_t packed_vector_get(const packed_vector *pv, int position);
+
+/*
+ * Overwrite the element numbered position with value. If the value does
+ * not fit in the current width, the vector is widened first.
+ */
+void packed_vector_set(packed_vector *pv, int position, uint32_t value);
+
+/*
+ * Append value to the end of the packed vector. If the value does not
+ * fit in the current width, the vector is widened first.
+ */
+void packed_vector_append(packed_vector *pv, uint32_t value);
+
+/*
+ * Copy the n elements starting at position start into out, one per
+ * uint32_t. Widths of 4, 8 and 16 bits are unpacked with SSE2 where it
+ * is available; this is much faster than n calls to packed_vector_get.
+ */
+void packed_vector_unpack(const packed_vector *pv, int start, int n,
+                          uint32_t out[]);
+
+#endif
@@ -0,0 +1,211 @@
+/*
+* Implementation of the sorted vector in C.
+* A full log is sorted and becomes the carry. The carry is merged with
+* run 0, then with run 1 and so on, until it reaches the first empty run
+* big enough to hold it, like a carry propagating through a binary
+* counter. The runs never own the elements' resources: they are vectors
+* without a free_fun, and sorted_vector_dispose frees the elements itself.
+*
+* Author:
+* Elizabeth Howe
+*/
+
+#include "sorted_vector.h"
+#include <assert.h>
+#include <string.h>
+
+/* O(1) */
+void sorted_vector_new(sorted_vector *sv, int elem_size,
+                       vector_cmp_fun cmp_fun, vector_free_fun free_fun)
+{
+    int k;
+
+    assert(elem_size > 0);
+    assert(cmp_fun != NULL);
+
+    sv->count = 0;
+    sv->elem_size = elem_size;
+    sv->cmp_fun = cmp_fun;
+    sv->free_fun = free_fun;
+    vector_new(&sv->log, elem_size, NULL, SORTED_VECTOR_LOG_CAPACITY);
+    for (k = 0; k < SORTED_VECTOR_MAX_RUNS; k++) {
+        vector_new(&sv->runs[k], elem_size, NULL, SORTED_VECTOR_LOG_CAPACITY);
+    }
+}
+
+/* O(n) */
+void sorted_vector_dispose(sorted_vector *sv)
+{
+    int k, i;
+
+    if (sv->free_fun != NULL) {
+        for (i = 0; i < vector_length(&sv->log); i++) {
+            sv->free_fun(vector_nth(&sv->log, i));
+        }
+        for (k = 0; k < SORTED_VECTOR_MAX_RUNS; k++) {
+            for (i = 0; i < vector_length(&sv->runs[k]); i++) {
+                sv->free_fun(vector_nth(&sv->runs[k], i));
+            }
+        }
+    }
+    vector_dispose(&sv->log);
+    for (k = 0; k < SORTED_VECTOR_MAX_RUNS; k++) {
+        vector_dispose(&sv->runs[k]);
+    }
+}
+
+/* O(1) */
+int sorted_vector_length(const sorted_vector *sv)
+{
+    return sv->count;
+}
+
+/*
+* O(n1 + n2)
+* Merge the sorted vectors older and newer into a new sorted vector.
+* Equal elements from newer go first. Nothing relies on that order:
+* a search may find any of the equal elements.
+*/
+static void merge_runs(const sorted_vector *sv, const vector *older,
+                       const vector *newer, vector *merged)
+{
+    int i = 0, j = 0;
+    int n_older = vector_length(older), n_newer = vector_length(newer);
+
+    vector_new(merged, sv->elem_size, NULL, n_older + n_newer);
+    while (i < n_older && j < n_newer) {
+        if (sv->cmp_fun(vector_nth(older, i), vector_nth(newer, j)) < 0) {
+            vector_append(merged, vector_nth(older, i++));
+        }
+        else {
+            vector_append(merged, vector_nth(newer, j++));
+        }
+    }
+    while (i < n_older) {
+        vector_append(merged, vector_nth(older, i++));
+    }
+    while (j < n_newer) {
+        vector_append(merged, vector_nth(newer, j++));
+    }
+}
+
+/* Replace run k with an empty vector, without touching its elements */
+static void clear_run(sorted_vector *sv, int k)
+{
+    vector_dispose(&sv->runs[k]);
+    vector_new(&sv->runs[k], sv->elem_size, NULL, SORTED_VECTOR_LOG_CAPACITY);
+}
+
+static long run_capacity(int k)
+{
+    return (long)SORTED_VECTOR_LOG_CAPACITY << k;
+}
+
+/*
+* O(n)
+* Merge the carry into the runs, starting at run k, until it fits in the
+* run it has emptied. The carry is consumed.
+* Return the run that now holds it.
+*/
+static int propagate(sorted_vector *sv, vector *carry, int k)
+{
+    vector merged;
+
+    for (; k < SORTED_VECTOR_MAX_RUNS - 1; k++) {
+        if (vector_length(&sv->runs[k]) > 0) {
+            merge_runs(sv, &sv->runs[k], carry, &merged);
+            vector_dispose(carry);
+            clear_run(sv, k);
+            *carry = merged;
+        }
+        if (vector_length(carry) <= run_capacity(k)) {
+            break;
+        }
+    }
+    if (vector_length(&sv->runs[k]) > 0) { // the last run takes everything
+        merge_runs(sv, &sv->runs[k], carry, &merged);
+        vector_dispose(carry);
+        *carry = merged;
+    }
+    vector_dispose(&sv->runs[k]);
+    sv->runs[k] = *carry;
+    return k;
+}
+
+/* Sort the log and merge it into the runs */
+static void flush_log(sorted_vector *sv)
+{
+    vector carry;
+
+    vector_sort(&sv->log, sv->cmp_fun);
+    carry = sv->log;
+    vector_new(&sv->log, sv->elem_size, NULL, SORTED_VECTOR_LOG_CAPACITY);
+    propagate(sv, &carry, 0);
+}
+
+/* Amortized O(log n) */
+void sorted_vector_insert(sorted_vector *sv, const void *elem_addr)
+{
+    if (vector_length(&sv->log) == SORTED_VECTOR_LOG_CAPACITY) {
+        flush_log(sv);
+    }
+    vector_append(&sv->log, elem_addr);
+    sv->count++;
+}
+
+/* O(log^2 n) */
+void *sorted_vector_search(const sorted_vector *sv, const void *key)
+{
+    int k, i;
+
+    assert(key != NULL);
+
+    // The log is unsorted, so it is scanned
+    for (i = vector_length(&sv->log) - 1; i >= 0; i--) {
+        if (sv->cmp_fun(key, vector_nth(&sv->log, i)) == 0) {
+            return vector_nth(&sv->log, i);
+        }
+    }
+    for (k = 0; k < SORTED_VECTOR_MAX_RUNS; k++) {
+        if (vector_length(&sv->runs[k]) == 0) {
+            continue;
+        }
+        i = vector_search(&sv->runs[k], key, sv->cmp_fun, 0, true);
+        if (i != -1) {
+            return vector_nth(&sv->runs[k], i);
+        }
+    }
+    return NULL;
+}
+
+/* O(n) */
+const vector *sorted_vector_compact(sorted_vector *sv)
+{
+    int k;
+    vector carry, merged;
+
+    if (vector_length(&sv->log) > 0) {
+        flush_log(sv);
+    }
+    // Gather every run into the carry, newest first
+    vector_new(&carry, sv->elem_size, NULL, SORTED_VECTOR_LOG_CAPACITY);
+    for (k = 0; k < SORTED_VECTOR_MAX_RUNS; k++) {
+        if (vector_length(&sv->runs[k]) > 0) {
+            merge_runs(sv, &sv->runs[k], &carry, &merged);
+            vector_dispose(&carry);
+            clear_run(sv, k);
+            carry = merged;
+        }
+    }
+    k = propagate(sv, &carry, 0);
+    return &sv->runs[k];
+}
+
+/* O(n) */
+void sorted_vector_map(sorted_vector *sv, vector_map_fun map_fun,
+                       void *aux_data)
+{
+    assert(map_fun != NULL);
+
+    vector_map((vector *)sorted_vector_compact(sv), map_fun, aux_data);
+}
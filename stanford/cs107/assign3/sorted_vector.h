@@ -0,0 +1,83 @@
+/*
+* Sorted vector API.
+*
+* Motivation:
+* Keeping a vector sorted under many inserts, with vector_insert at the
+* right position or with vector_append followed by vector_sort, costs
+* O(n) or O(n log n) per insert. The sorted vector instead buffers new
+* elements in a small unsorted log. When the log is full it is sorted and
+* merged, with linear merges, into a short list of sorted runs whose
+* lengths grow geometrically, as in a log-structured merge tree.
+* Each element takes part in O(log n) merges, so inserts cost amortized
+* O(log n). A search scans the log and binary searches each run.
+*
+* Author:
+* Elizabeth Howe
+*/
+
+#ifndef _SORTED_VECTOR_H_
+#define _SORTED_VECTOR_H_
+
+#include "vector.h"
+
+enum {
+    SORTED_VECTOR_LOG_CAPACITY = 32, // elements buffered before a merge
+    SORTED_VECTOR_MAX_RUNS = 32, // run k holds up to LOG_CAPACITY << k elements
+};
+
+/* The internal representation of a sorted vector */
+typedef struct {
+    vector log; // the most recent inserts, unsorted
+    vector runs[SORTED_VECTOR_MAX_RUNS]; // sorted, empty or newer than run k + 1
+    int count;
+    int elem_size;
+    vector_cmp_fun cmp_fun;
+    vector_free_fun free_fun;
+} sorted_vector;
+
+/*
+ * Usage: sorted_vector sv;
+ *        sorted_vector_new(&sv, sizeof(long), compare_long, NULL);
+ *
+ * Construct an empty sorted vector in the caller's stack, ordered by
+ * cmp_fun. free_fun is called on each element by sorted_vector_dispose;
+ * if it is NULL, the elements don't require any special handling.
+ */
+void sorted_vector_new(sorted_vector *sv, int elem_size,
+                       vector_cmp_fun cmp_fun, vector_free_fun free_fun);
+
+/* Free up memory consumed by sorted vector */
+void sorted_vector_dispose(sorted_vector *sv);
+
+/* Return the number of elements in the sorted vector. */
+int sorted_vector_length(const sorted_vector *sv);
+
+/*
+ * Insert a copy of the element at elem_addr. Equal elements are kept
+ * side by side, as with vector_insert.
+ */
+void sorted_vector_insert(sorted_vector *sv, const void *elem_addr);
+
+/*
+ * Search for an element equal to the key, in the cmp_fun sense.
+ * If several are equal, any one of them may be found.
+ * Return the address of the element, or NULL if there is none. The
+ * address is valid until the next insert.
+ */
+void *sorted_vector_search(const sorted_vector *sv, const void *key);
+
+/*
+ * Merge the log and all the runs into a single sorted run and return it.
+ * The returned vector must not be modified, and is valid until the next
+ * insert. This is the way to read the elements in order, by position.
+ */
+const vector *sorted_vector_compact(sorted_vector *sv);
+
+/*
+ * Apply map_fun to each element, in sorted order. This compacts the
+ * sorted vector first. map_fun must not change how elements compare.
+ */
+void sorted_vector_map(sorted_vector *sv, vector_map_fun map_fun,
+                       void *aux_data);
+
+#endif
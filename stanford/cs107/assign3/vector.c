@@ -8,13 +8,28 @@
 */
 
 #include "vector.h"
+#include "image.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <assert.h>
 #include <search.h>
+#include <errno.h>
+#include <limits.h>
 
 static const int default_internal_length = 10;
+static const char vector_magic[8] = "VECTIMG";
+
+enum {
+    VECTOR_IMAGE_VERSION = 1,
+};
+
+/* The header of a vector image. The elements follow it. */
+typedef struct {
+    image_header common;
+    uint64_t elem_size;
+    uint64_t length;
+} vector_image;
 
 /* O(1) */
 void vector_new(vector *v, int elem_size, 
@@ -30,6 +45,8 @@ void vector_new(vector *v, int elem_size,
     v->elems = malloc(v->internal_length * v->elem_size);
     assert(v->elems != NULL);
     v->free_fun = free_fun;
+    v->image = NULL;
+    v->image_size = 0;
 }
 
 /* O(n) */
@@ -43,7 +60,12 @@ void vector_dispose(vector *v) {
             (v->free_fun)(p);
         }
     }
-    free(v->elems);
+    if (v->image != NULL) {
+        image_unmap(v->image, v->image_size);
+    }
+    else {
+        free(v->elems);
+    }
 }
 
 /* O(1) */
@@ -71,8 +93,21 @@ void vector_elem_replace(vector *v, const void *elem_addr, int position) {
 }
 
 static void vector_grow(vector *v) {
+    void *elems;
+
     v->internal_length += v->n_elems_grow_by;
-    v->elems = realloc(v->elems, v->elem_size * v->internal_length);
+    if (v->image != NULL) {
+        // Move off the image, which cannot grow
+        elems = malloc((size_t)v->elem_size * v->internal_length);
+        assert(elems != NULL);
+        memcpy(elems, v->elems, (size_t)v->elem_size * v->logical_length);
+        image_unmap(v->image, v->image_size);
+        v->image = NULL;
+        v->elems = elems;
+    }
+    else {
+        v->elems = realloc(v->elems, v->elem_size * v->internal_length);
+    }
 }
 
 /* O(n) neglecting any memoary reallocation time */
@@ -179,4 +214,65 @@ int vector_search(const vector *v, const void *key, vector_cmp_fun search_fun,
     }
     bytes_offset = (char *)ret - (char *)v->elems;
     return bytes_offset / v->elem_size;
-}
\ No newline at end of file
+}
+
+/* O(n) */
+bool vector_save(const vector *v, const char *path)
+{
+    vector_image header;
+    FILE *fp;
+    bool ok;
+
+    assert(v->free_fun == NULL);
+
+    memset(&header, 0, sizeof(header));
+    image_header_init(&header.common, vector_magic, VECTOR_IMAGE_VERSION);
+    header.elem_size = v->elem_size;
+    header.length = v->logical_length;
+
+    fp = fopen(path, "wb");
+    if (fp == NULL) {
+        return false;
+    }
+    ok = image_write_section(fp, &header, sizeof(header)) &&
+         image_write_section(fp, v->elems,
+                             (size_t)v->elem_size * v->logical_length);
+    if (fclose(fp) != 0) {
+        ok = false;
+    }
+    return ok;
+}
+
+/* O(1), the pages are read in as they are touched */
+bool vector_load(vector *v, const char *path)
+{
+    const vector_image *header;
+    size_t size, offset;
+    void *image;
+
+    image = image_map(path, &size);
+    if (image == NULL) {
+        return false;
+    }
+    header = image;
+    offset = image_align(sizeof(vector_image));
+    if (!image_check(image, size, vector_magic, VECTOR_IMAGE_VERSION,
+                     sizeof(vector_image)) ||
+        header->elem_size == 0 || header->elem_size > INT_MAX ||
+        header->length > INT_MAX ||
+        size < offset + header->elem_size * header->length) {
+        image_unmap(image, size);
+        errno = EINVAL;
+        return false;
+    }
+    v->elem_size = header->elem_size;
+    v->logical_length = header->length;
+    v->internal_length = header->length;
+    v->n_elems_grow_by = header->length > default_internal_length ?
+                            header->length : default_internal_length;
+    v->elems = (char *)image + offset;
+    v->free_fun = NULL;
+    v->image = image;
+    v->image_size = size;
+    return true;
+}
@@ -43,6 +43,18 @@ typedef void (*vector_map_fun)(void *elem_addr, void *aux_data);
  */
 typedef void (*vector_free_fun)(void *elem_addr);
 
+/*
+ * A client-supplied function pointer used by vector_map_reduce to fold the
+ * aux data at from_addr into the aux data at into_addr.
+ */
+typedef void (*vector_reduce_fun)(void *into_addr, const void *from_addr);
+
+/* How the chunks of a parallel map are shared among the threads */
+typedef enum {
+    VECTOR_SCHEDULE_STATIC, // each thread takes an equal range of chunks
+    VECTOR_SCHEDULE_DYNAMIC, // each thread takes the next chunk when done
+} vector_schedule;
+
 /* 
  * Usage: vector v;
  *        vector_new(&v, sizeof(char *), my_string_free, 10);
@@ -132,4 +144,63 @@ void vector_sort(vector *v, vector_cmp_fun comparefn);
  */
 void vector_map(vector *v, vector_map_fun map_fun, void *aux_data);
 
+/*
+ * Usage: vector_map_parallel(&v, score, &weights, 0);
+ *
+ * Like vector_map, but the elements are split into chunks of consecutive
+ * elements that nthreads threads, the calling thread included, map over
+ * in parallel. If nthreads is 0, one thread per online CPU is used.
+ * Chunks are scheduled dynamically, which balances callbacks of uneven
+ * cost. The elements are visited in no particular order.
+ *
+ * map_fun is called concurrently on distinct elements, all with the same
+ * aux_data, so it must not write to aux_data without synchronization.
+ * Use vector_map_reduce to accumulate results instead.
+ */
+void vector_map_parallel(vector *v, vector_map_fun map_fun, void *aux_data,
+                         int nthreads);
+
+/*
+ * Usage: long sum = 0;
+ *        vector_map_reduce(&v, add_long, &sum, sizeof(sum), sum_longs, 0,
+ *                          VECTOR_SCHEDULE_STATIC);
+ *
+ * Map over the vector in parallel as vector_map_parallel does, but give
+ * every chunk its own copy of the aux_size bytes at aux_data, so map_fun
+ * may update its aux data freely. On entry aux_data must hold the identity
+ * of reduce_fun, e.g. zero for a sum. On return it holds the chunks' aux
+ * data folded together by reduce_fun, in chunk order.
+ *
+ * The chunks depend only on the length of the vector, so the result is
+ * the same whatever nthreads and schedule are, even for a reduce_fun that
+ * is not associative such as a floating point sum.
+ */
+void vector_map_reduce(vector *v, vector_map_fun map_fun, void *aux_data,
+                       int aux_size, vector_reduce_fun reduce_fun,
+                       int nthreads, vector_schedule schedule);
+
+/*
+ * Usage: if (!vector_save(&v, "numbers.img")) { perror("numbers.img"); }
+ *
+ * Write the elements of the vector to a binary image file at path.
+ * The elements are written byte for byte, so they must be plain old data:
+ * the vector must have no free_fun and the elements must hold no pointers.
+ * The image records the element size, the length, a version and the byte
+ * order, and can only be loaded on a machine of the same byte order.
+ * Return false on an I/O error, with errno set.
+ */
+bool vector_save(const vector *v, const char *path);
+
+/*
+ * Construct a vector in the caller's stack from an image written by
+ * vector_save. The image is mapped rather than read, so loading takes the
+ * same time whatever its size. The vector can then be used as any other:
+ * writes go to private copies of the touched pages, never to the file,
+ * and the first time it grows the elements are copied to the heap.
+ * Dispose of the vector with vector_dispose.
+ * Return false, with errno set, if the file cannot be mapped or is not a
+ * vector image of this version.
+ */
+bool vector_load(vector *v, const char *path);
+
 #endif
\ No newline at end of file
@@ -3,6 +3,8 @@
 * Elizabeth Howe
 */
 
+#include <stddef.h>
+
 /* The internal representation of the vector */
 typedef struct {
   void *elems; // pointer to the underlying array
@@ -11,4 +13,6 @@ typedef struct {
   int internal_length; // current max number of elements the array can have
   int n_elems_grow_by;
   void (*free_fun)(void *);
+  void *image; // mapping that elems points into, NULL if elems is malloc'd
+  size_t image_size;
 } vector;
\ No newline at end of file
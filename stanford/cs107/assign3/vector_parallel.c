@@ -0,0 +1,187 @@
+/*
+* Implementation of the parallel maps over a vector in C.
+* The vector is split into at most MAX_CHUNKS chunks of consecutive
+* elements, a number that depends only on the length of the vector.
+* The calling thread and nthreads - 1 helper threads then map over the
+* chunks, either taking fixed ranges of chunks (static scheduling) or
+* claiming the next chunk from a shared counter until none are left
+* (dynamic scheduling).
+* vector_map_reduce gives every chunk its own copy of the aux data and
+* reduces the copies in chunk order once all threads are done, so the
+* result does not depend on the number of threads or on the schedule.
+*
+* Author:
+* Elizabeth Howe
+*/
+
+#include "vector.h"
+#include <assert.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+enum {
+    MAX_CHUNKS = 256,
+    MAX_THREADS = 64,
+};
+
+/* The state shared by the threads of one map */
+typedef struct {
+    vector *v;
+    vector_map_fun map_fun;
+    void *aux_data; // shared by all chunks, or
+    char *chunk_aux; // one slot of aux_size bytes per chunk
+    int aux_size;
+    int chunk_length;
+    int n_chunks;
+    int nthreads;
+    vector_schedule schedule;
+    int next_chunk; // dynamic scheduling only
+} map_job;
+
+/* A helper thread's view of the job */
+typedef struct {
+    map_job *job;
+    int id;
+} map_worker;
+
+static void map_chunk(map_job *job, int chunk)
+{
+    int i, end;
+    void *aux;
+
+    aux = job->chunk_aux != NULL ?
+          job->chunk_aux + (size_t)chunk * job->aux_size : job->aux_data;
+    end = (chunk + 1) * job->chunk_length;
+    if (end > job->v->logical_length) {
+        end = job->v->logical_length;
+    }
+    for (i = chunk * job->chunk_length; i < end; i++) {
+        job->map_fun((char *)job->v->elems + (size_t)i * job->v->elem_size, aux);
+    }
+}
+
+static void *map_worker_run(void *arg)
+{
+    map_worker *worker = arg;
+    map_job *job = worker->job;
+    int chunk, end;
+
+    if (job->schedule == VECTOR_SCHEDULE_STATIC) {
+        end = (int)((long)job->n_chunks * (worker->id + 1) / job->nthreads);
+        for (chunk = (int)((long)job->n_chunks * worker->id / job->nthreads);
+             chunk < end; chunk++) {
+            map_chunk(job, chunk);
+        }
+    }
+    else {
+        while ((chunk = __atomic_fetch_add(&job->next_chunk, 1,
+                                           __ATOMIC_RELAXED)) < job->n_chunks) {
+            map_chunk(job, chunk);
+        }
+    }
+    return NULL;
+}
+
+/*
+* Run the job on nthreads threads, the calling thread included.
+* If a helper thread cannot be created, the calling thread does its share.
+*/
+static void map_job_run(map_job *job)
+{
+    pthread_t threads[MAX_THREADS];
+    map_worker workers[MAX_THREADS];
+    bool started[MAX_THREADS];
+    int i;
+
+    for (i = 0; i < job->nthreads; i++) {
+        workers[i].job = job;
+        workers[i].id = i;
+        started[i] = i > 0 && pthread_create(&threads[i], NULL, map_worker_run,
+                                             &workers[i]) == 0;
+    }
+    for (i = 0; i < job->nthreads; i++) {
+        if (!started[i]) {
+            map_worker_run(&workers[i]);
+        }
+    }
+    for (i = 1; i < job->nthreads; i++) {
+        if (started[i]) {
+            pthread_join(threads[i], NULL);
+        }
+    }
+}
+
+static void map_job_init(map_job *job, vector *v, vector_map_fun map_fun,
+                         int nthreads, vector_schedule schedule)
+{
+    assert(map_fun != NULL);
+    assert(schedule == VECTOR_SCHEDULE_STATIC ||
+           schedule == VECTOR_SCHEDULE_DYNAMIC);
+
+    if (nthreads <= 0) {
+        nthreads = (int)sysconf(_SC_NPROCESSORS_ONLN);
+    }
+    if (nthreads > MAX_THREADS) {
+        nthreads = MAX_THREADS;
+    }
+    if (nthreads < 1) {
+        nthreads = 1;
+    }
+    memset(job, 0, sizeof(*job));
+    job->v = v;
+    job->map_fun = map_fun;
+    job->chunk_length = (v->logical_length + MAX_CHUNKS - 1) / MAX_CHUNKS;
+    if (job->chunk_length == 0) {
+        job->chunk_length = 1;
+    }
+    job->n_chunks = (v->logical_length + job->chunk_length - 1) /
+                    job->chunk_length;
+    job->nthreads = nthreads < job->n_chunks ? nthreads : job->n_chunks;
+    job->schedule = schedule;
+}
+
+/* O(n / nthreads) */
+void vector_map_parallel(vector *v, vector_map_fun map_fun, void *aux_data,
+                         int nthreads)
+{
+    map_job job;
+
+    map_job_init(&job, v, map_fun, nthreads, VECTOR_SCHEDULE_DYNAMIC);
+    job.aux_data = aux_data;
+    if (job.n_chunks > 0) {
+        map_job_run(&job);
+    }
+}
+
+/* O(n / nthreads + number of chunks) */
+void vector_map_reduce(vector *v, vector_map_fun map_fun, void *aux_data,
+                       int aux_size, vector_reduce_fun reduce_fun,
+                       int nthreads, vector_schedule schedule)
+{
+    map_job job;
+    int i;
+
+    assert(aux_data != NULL);
+    assert(aux_size > 0);
+    assert(reduce_fun != NULL);
+
+    map_job_init(&job, v, map_fun, nthreads, schedule);
+    if (job.n_chunks == 0) {
+        return; // aux_data already holds the identity
+    }
+    job.aux_size = aux_size;
+    job.chunk_aux = malloc((size_t)job.n_chunks * aux_size);
+    assert(job.chunk_aux != NULL);
+    for (i = 0; i < job.n_chunks; i++) {
+        memcpy(job.chunk_aux + (size_t)i * aux_size, aux_data, aux_size);
+    }
+    map_job_run(&job);
+
+    memcpy(aux_data, job.chunk_aux, aux_size);
+    for (i = 1; i < job.n_chunks; i++) {
+        reduce_fun(aux_data, job.chunk_aux + (size_t)i * aux_size);
+    }
+    free(job.chunk_aux);
+}
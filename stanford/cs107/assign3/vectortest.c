@@ -6,6 +6,10 @@
  */
 
 #include "vector.h"
+#include "sorted_vector.h"
+#include "packed_vector.h"
+#include "cow_vector.h"
+#include <pthread.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -400,6 +404,293 @@ static void MemoryTest()
   vector_dispose(&questionWords);
 }
 
+/**
+ * Function: ImageTest
+ * -------------------
+ * Saves a vector of longs to an image file and loads it back.  The
+ * loaded vector must hold the same numbers, must accept writes without
+ * touching the file, and must grow off the image when appended to.
+ * Loading a file that is not an image must fail.
+ */
+
+static void ImageTest()
+{
+  const char *kImageFile = "vectortest.img";
+  const long kNumNumbers = 100000;
+  vector numbers, loaded, reloaded;
+  long i, number;
+
+  fprintf(stdout, "\n\n------------------------- Starting the image tests...\n");
+  vector_new(&numbers, sizeof(long), NULL, 0);
+  for (i = 0; i < kNumNumbers; i++) {
+    number = i * i;
+    vector_append(&numbers, &number);
+  }
+  assert(vector_save(&numbers, kImageFile));
+  assert(vector_load(&loaded, kImageFile));
+  assert(vector_length(&loaded) == kNumNumbers);
+  for (i = 0; i < kNumNumbers; i++)
+    assert(*(long *)vector_nth(&loaded, i) == i * i);
+  fprintf(stdout, "Saved and loaded %ld longs.\n", kNumNumbers);
+
+  number = -1;
+  vector_elem_replace(&loaded, &number, 0);
+  assert(vector_load(&reloaded, kImageFile)); // the file is unchanged
+  assert(*(long *)vector_nth(&reloaded, 0) == 0);
+  vector_dispose(&reloaded);
+
+  for (i = 0; i < 10; i++)
+    vector_append(&loaded, &i);
+  assert(vector_length(&loaded) == kNumNumbers + 10);
+  assert(*(long *)vector_nth(&loaded, 0) == -1);
+  assert(*(long *)vector_nth(&loaded, kNumNumbers - 1) == (kNumNumbers - 1) * (kNumNumbers - 1));
+  assert(*(long *)vector_nth(&loaded, kNumNumbers + 9) == 9);
+  fprintf(stdout, "Appended to the loaded vector.\n");
+  vector_dispose(&loaded);
+  vector_dispose(&numbers);
+  remove(kImageFile);
+
+  assert(!vector_load(&loaded, "vectortest.c"));
+  fprintf(stdout, "Refused to load a file that is not an image.\n");
+}
+
+/**
+ * Functions: SquareLong, AddReciprocal, AddDoubles
+ * ------------------------------------------------
+ * Callbacks for the parallel tests.  SquareLong updates elements in
+ * place, AddReciprocal accumulates into its chunk's double, and
+ * AddDoubles folds two of those doubles together.
+ */
+
+static void SquareLong(void *elemAddr, void *auxData)
+{
+  *(long *)elemAddr *= *(long *)elemAddr;
+}
+
+static void AddReciprocal(void *elemAddr, void *auxData)
+{
+  *(double *)auxData += 1.0 / *(long *)elemAddr;
+}
+
+static void AddDoubles(void *intoAddr, const void *fromAddr)
+{
+  *(double *)intoAddr += *(const double *)fromAddr;
+}
+
+/**
+ * Function: ParallelTest
+ * ----------------------
+ * Squares a vector of longs in parallel and checks every element, then
+ * sums the reciprocals of the squares with every combination of thread
+ * count and schedule.  Floating point addition is not associative, so
+ * the sums are only bit for bit equal if the reduction is deterministic.
+ */
+
+static void ParallelTest()
+{
+  const long kNumNumbers = 200003;
+  const int kThreadCounts[] = {1, 2, 3, 8};
+  vector numbers, empty;
+  long i;
+  int t;
+  double sum, expected;
+  vector_schedule schedule;
+
+  fprintf(stdout, "\n\n------------------------- Starting the parallel tests...\n");
+  vector_new(&numbers, sizeof(long), NULL, kNumNumbers);
+  for (i = 1; i <= kNumNumbers; i++)
+    vector_append(&numbers, &i);
+  vector_map_parallel(&numbers, SquareLong, NULL, 4);
+  for (i = 1; i <= kNumNumbers; i++)
+    assert(*(long *)vector_nth(&numbers, i - 1) == i * i);
+  fprintf(stdout, "Squared %ld longs in parallel.\n", kNumNumbers);
+
+  expected = 0.0;
+  vector_map_reduce(&numbers, AddReciprocal, &expected, sizeof(double), AddDoubles, 1, VECTOR_SCHEDULE_STATIC);
+  for (schedule = VECTOR_SCHEDULE_STATIC; schedule <= VECTOR_SCHEDULE_DYNAMIC; schedule++) {
+    for (t = 0; t < sizeof(kThreadCounts) / sizeof(kThreadCounts[0]); t++) {
+      sum = 0.0;
+      vector_map_reduce(&numbers, AddReciprocal, &sum, sizeof(double), AddDoubles, kThreadCounts[t], schedule);
+      assert(memcmp(&sum, &expected, sizeof(double)) == 0);
+    }
+  }
+  assert(expected > 1.64 && expected < 1.65); // pi^2 / 6
+  fprintf(stdout, "Sum of reciprocal squares is %.12f with every thread count and schedule.\n", expected);
+  vector_dispose(&numbers);
+
+  vector_new(&empty, sizeof(long), NULL, 0);
+  sum = 0.0;
+  vector_map_reduce(&empty, AddReciprocal, &sum, sizeof(double), AddDoubles, 0, VECTOR_SCHEDULE_DYNAMIC);
+  assert(sum == 0.0);
+  vector_dispose(&empty);
+}
+
+/**
+ * Function: SortedVectorTest
+ * --------------------------
+ * Inserts a permutation of a large range of longs into a sorted vector,
+ * searching for every other number along the way, and then checks that
+ * compaction yields the range in order.  Then inserts a second copy of
+ * some numbers and checks that equal elements are kept side by side.
+ */
+
+static void SortedVectorTest()
+{
+  sorted_vector sorted;
+  const vector *compacted;
+  long i, residue;
+  const long kNumNumbers = 100003;  // prime, so that k * 7919 % n is a permutation
+
+  fprintf(stdout, "\n\n------------------------- Starting the sorted vector tests...\n");
+  sorted_vector_new(&sorted, sizeof(long), LongCompare, NULL);
+  for (i = 0; i < kNumNumbers; i++) {
+    residue = i * 7919 % kNumNumbers;
+    sorted_vector_insert(&sorted, &residue);
+    assert(*(long *)sorted_vector_search(&sorted, &residue) == residue);
+    if (i % 1000 == 0) {
+      residue = -residue - 1;
+      assert(sorted_vector_search(&sorted, &residue) == NULL);
+    }
+  }
+  assert(sorted_vector_length(&sorted) == kNumNumbers);
+  for (i = 0; i < kNumNumbers; i++)
+    assert(*(long *)sorted_vector_search(&sorted, &i) == i);
+  compacted = sorted_vector_compact(&sorted);
+  assert(vector_length(compacted) == kNumNumbers);
+  for (i = 0; i < kNumNumbers; i++)
+    assert(*(long *)vector_nth(compacted, i) == i);
+  fprintf(stdout, "Inserted %ld numbers, all found and in order.\n", kNumNumbers);
+
+  for (i = 0; i < kNumNumbers; i += 2)
+    sorted_vector_insert(&sorted, &i);
+  compacted = sorted_vector_compact(&sorted);
+  assert(vector_length(compacted) == kNumNumbers + (kNumNumbers + 1) / 2);
+  for (i = 1; i < vector_length(compacted); i++)
+    assert(LongCompare(vector_nth(compacted, i - 1), vector_nth(compacted, i)) <= 0);
+  fprintf(stdout, "Duplicates kept in order.\n");
+  sorted_vector_dispose(&sorted);
+}
+
+/**
+ * Function: PackedVectorTest
+ * --------------------------
+ * Appends numbers that grow past 4, 8, 16 and 31 bits to a packed vector
+ * starting at 4 bits, checking that the vector widens and that every
+ * number survives each widening.  At every width the vector passes
+ * through, bulk unpacking from every start offset must agree with
+ * packed_vector_get.  Finally overwrites every third number.
+ */
+
+static void PackedVectorTest()
+{
+  const int kLimits[] = {16, 256, 65536, 1 << 20, INT_MAX};
+  const int kNumLimits = sizeof(kLimits) / sizeof(kLimits[0]);
+  const int kNumPerLimit = 1000;
+  packed_vector packed;
+  uint32_t *unpacked, expected;
+  int i, j, start;
+
+  fprintf(stdout, "\n\n------------------------- Starting the packed vector tests...\n");
+  packed_vector_new(&packed, 4, 0);
+  unpacked = malloc(kNumLimits * kNumPerLimit * sizeof(uint32_t));
+  assert(unpacked != NULL);
+  for (i = 0; i < kNumLimits; i++) {
+    for (j = 0; j < kNumPerLimit; j++)
+      packed_vector_append(&packed, (uint32_t)((j * 2654435761u) % kLimits[i]));
+    fprintf(stdout, "Width is %d bits after %d numbers.\n", packed_vector_width(&packed), packed_vector_length(&packed));
+    for (start = 0; start < 40; start++) {
+      packed_vector_unpack(&packed, start, packed_vector_length(&packed) - start, unpacked);
+      for (j = start; j < packed_vector_length(&packed); j++)
+        assert(unpacked[j - start] == packed_vector_get(&packed, j));
+    }
+  }
+  assert(packed_vector_width(&packed) == 31);
+  for (i = 0; i < kNumLimits; i++) {
+    for (j = 0; j < kNumPerLimit; j++) {
+      expected = (uint32_t)((j * 2654435761u) % kLimits[i]);
+      assert(packed_vector_get(&packed, i * kNumPerLimit + j) == expected);
+    }
+  }
+  for (i = 0; i < packed_vector_length(&packed); i += 3)
+    packed_vector_set(&packed, i, UINT32_MAX - i);
+  assert(packed_vector_width(&packed) == 32);
+  for (i = 0; i < packed_vector_length(&packed); i++)
+    if (i % 3 == 0)
+      assert(packed_vector_get(&packed, i) == UINT32_MAX - i);
+  fprintf(stdout, "All %d numbers survived widening to 32 bits.\n", packed_vector_length(&packed));
+  free(unpacked);
+  packed_vector_dispose(&packed);
+}
+
+/**
+ * Function: ScanSnapshot
+ * ----------------------
+ * Reader thread for CowVectorTest.  Scans the snapshot it is handed
+ * several times, checking that element i is still i every time, and
+ * disposes of it.
+ */
+
+static void *ScanSnapshot(void *snapshot)
+{
+  int pass;
+  long i;
+
+  for (pass = 0; pass < 20; pass++)
+    for (i = 0; i < cow_vector_length(snapshot); i++)
+      assert(*(const long *)cow_vector_nth(snapshot, i) == i);
+  cow_vector_dispose(snapshot);
+  return NULL;
+}
+
+/**
+ * Function: CowVectorTest
+ * -----------------------
+ * Builds a copy-on-write vector of longs, snapshots it and hands the
+ * snapshot to a reader thread.  Meanwhile the writer overwrites every
+ * element and keeps appending, which must not disturb the reader.  Then
+ * checks that a snapshot taken and written by the same thread diverges
+ * from the vector it was taken from.
+ */
+
+static void CowVectorTest()
+{
+  const long kNumNumbers = 100000;
+  cow_vector numbers, snapshot, mine;
+  pthread_t reader;
+  long i, negated;
+
+  fprintf(stdout, "\n\n------------------------- Starting the copy-on-write vector tests...\n");
+  cow_vector_new(&numbers, sizeof(long), 100);
+  for (i = 0; i < kNumNumbers; i++)
+    cow_vector_append(&numbers, &i);
+  cow_vector_snapshot(&numbers, &snapshot);
+  assert(pthread_create(&reader, NULL, ScanSnapshot, &snapshot) == 0);
+  for (i = 0; i < kNumNumbers; i++) {
+    negated = -i;
+    cow_vector_replace(&numbers, &negated, i);
+  }
+  for (i = kNumNumbers; i < 2 * kNumNumbers; i++)
+    cow_vector_append(&numbers, &i);
+  assert(pthread_join(reader, NULL) == 0);
+  assert(cow_vector_length(&numbers) == 2 * kNumNumbers);
+  for (i = 0; i < 2 * kNumNumbers; i++)
+    assert(*(const long *)cow_vector_nth(&numbers, i) == (i < kNumNumbers ? -i : i));
+  fprintf(stdout, "Reader saw a consistent snapshot while the writer changed %ld numbers.\n", 2 * kNumNumbers);
+
+  cow_vector_snapshot(&numbers, &mine);
+  negated = 42;
+  cow_vector_replace(&mine, &negated, 0);
+  cow_vector_append(&mine, &negated);
+  assert(*(const long *)cow_vector_nth(&numbers, 0) == 0);
+  assert(*(const long *)cow_vector_nth(&mine, 0) == 42);
+  assert(cow_vector_length(&numbers) == 2 * kNumNumbers);
+  assert(cow_vector_length(&mine) == 2 * kNumNumbers + 1);
+  cow_vector_dispose(&numbers);
+  assert(*(const long *)cow_vector_nth(&mine, 1) == -1);
+  cow_vector_dispose(&mine);
+  fprintf(stdout, "Snapshot and vector diverged.\n");
+}
+
 /**
  * Function: main
  * --------------
@@ -413,6 +704,11 @@ int main(int ignored, char **alsoIgnored)
   SimpleTest();
   ChallengingTest();
   MemoryTest();
+  ImageTest();
+  ParallelTest();
+  SortedVectorTest();
+  PackedVectorTest();
+  CowVectorTest();
   return 0;
 }
 